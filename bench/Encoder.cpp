@@ -0,0 +1,266 @@
+#include "mc/MCBatchEncoder.hpp"
+#include "mc/MCEncoder.hpp"
+#include "mc/MCInst.hpp"
+#include "mc/MCInstStore.hpp"
+#include "mc/MCOpCode.hpp"
+#include "mc/MCOperand.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <print>
+#include <vector>
+
+/// usage: bench_encoder
+///
+/// encodes one inst of every opcode in RISCV.def, grouped by format, through
+/// the former EnCoding interpreter and the precompiled mc::Encoders, and
+/// checks that both agree on every inst.
+/// then encodes a compiler-like .text (mostly I and R) inst by inst from
+/// MCInsts and with mc::encodeText from an MCInstStore, and checks that both
+/// give the same bytes
+
+namespace {
+
+/// what MCInst::makeEncoding did before: walk the EnCodings, rescan the
+/// operands for every field, insert the imm one bit range at a time.
+/// the slice is done in 64 bits, the old one lost imm[31:12] to 1 << 32
+uint32_t interpret(const mc::MCInst& Inst) {
+  using mc::EnCoding;
+
+  auto findRegOp = [&](unsigned idx) -> const mc::MCOperand& {
+    unsigned i = Inst.getOpCode()->hasRd ? 0 : 1;
+    for (auto& op : Inst) {
+      if (!op.isReg()) {
+        continue;
+      }
+      if (i == idx) {
+        return op;
+      }
+      ++i;
+    }
+    utils::unreachable("cant find the right reg op");
+  };
+
+  auto findGImmOp = [&]() -> const mc::MCOperand& {
+    for (auto& op : Inst) {
+      if (op.isGImm()) {
+        return op;
+      }
+    }
+    utils::unreachable("cant find the imm op");
+  };
+
+  uint32_t bits = 0;
+  unsigned len = 0;
+  auto add = [&](uint64_t elem, unsigned length) {
+    bits |= static_cast<uint32_t>(elem & ((1ull << length) - 1)) << len;
+    len += length;
+  };
+
+  for (auto& encode : Inst.getOpCode()->encodings) {
+    switch (encode.kind) {
+    case EnCoding::kInvalid:
+      continue;
+    case EnCoding::kStatic:
+      add(*encode.static_pattern, encode.length);
+      break;
+    case EnCoding::kRd:
+    case EnCoding::kRd_short:
+      add(findRegOp(0).getReg(), encode.length);
+      break;
+    case EnCoding::kRs1:
+    case EnCoding::kRs1_short:
+      add(findRegOp(1).getReg(), encode.length);
+      break;
+    case EnCoding::kRs2:
+    case EnCoding::kRs2_short:
+      add(findRegOp(2).getReg(), encode.length);
+      break;
+    case EnCoding::kRs3:
+    case EnCoding::kRs3_short:
+      add(findRegOp(3).getReg(), encode.length);
+      break;
+    default: {
+      auto gimm =
+          utils::signIntCompress(findGImmOp().getGImm(), encode.highest + 1);
+
+      unsigned used = 0;
+      for (auto [high, low] : *encode.bit_range) {
+        if (used == encode.length) {
+          break;
+        }
+        add(gimm >> low, high - low + 1);
+        used += high - low + 1;
+      }
+    }
+    }
+  }
+
+  return bits;
+}
+
+const char* formatOf(const mc::MCOpCode& Op) {
+  mc::MCEncoder E(Op);
+
+  if (E.Length == 16) {
+    return "C";
+  }
+  if (!E.NumImms) {
+    return E.RegsNeeded == 4 ? "R4" : "R";
+  }
+  switch (E.ImmBits) {
+  case 32:
+    return "U";
+  case 21:
+    return "J";
+  case 13:
+    return "B";
+  default:
+    return Op.hasRd ? "I" : "S";
+  }
+}
+
+template <typename Fn>
+double encodesPerSecond(const std::vector<mc::MCInst>& Insts, unsigned Rounds,
+                        uint32_t& Sum, Fn&& Encode) {
+  auto Begin = std::chrono::steady_clock::now();
+
+  for (unsigned r = 0; r < Rounds; ++r) {
+    for (const auto& Inst : Insts) {
+      Sum += Encode(Inst);
+    }
+  }
+
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Begin;
+
+  return static_cast<double>(Insts.size()) * Rounds / Elapsed.count();
+}
+
+} // namespace
+
+int main() {
+  constexpr std::array<const char*, 7> Formats{"R", "R4", "I", "S",
+                                               "B", "U",  "J"};
+  constexpr std::size_t Variants = 64;
+
+  std::vector<std::vector<mc::MCInst>> Groups(Formats.size() + 1);
+  std::size_t Mismatch = 0;
+
+  for (std::size_t i = 0; i < parser::MnemonicCnt; ++i) {
+    const auto& Op = *parser::MnemonicOpCodes[i];
+    mc::MCEncoder E(Op);
+
+    auto Format = formatOf(Op);
+    std::size_t Group = Formats.size();
+    for (std::size_t f = 0; f < Formats.size(); ++f) {
+      if (StringRef(Format) == StringRef(Formats[f])) {
+        Group = f;
+      }
+    }
+
+    /// small even imms fit every field of every format
+    for (std::size_t v = 0; v < Variants; ++v) {
+      mc::MCInst Inst(&Op);
+      for (unsigned r = 0; r < E.RegsNeeded; ++r) {
+        Inst.addOperand(mc::MCOperand::makeReg((v * 7 + r * 5) % 32));
+      }
+      if (E.NumImms) {
+        Inst.addOperand(mc::MCOperand::makeImm(static_cast<int64_t>(v % 8) - 4));
+      }
+
+      Mismatch += interpret(Inst) != Inst.makeEncoding();
+      Groups[Group].push_back(std::move(Inst));
+    }
+  }
+
+  std::print("{:>6} {:>8} {:>14} {:>14} {:>8}\n", "format", "insts",
+             "interpreted/s", "precompiled/s", "speedup");
+
+  uint32_t Sum = 0;
+  for (std::size_t g = 0; g < Groups.size(); ++g) {
+    const auto& Insts = Groups[g];
+    if (Insts.empty()) {
+      continue;
+    }
+
+    unsigned Rounds = (1u << 22) / Insts.size() + 1;
+
+    auto Old = encodesPerSecond(Insts, Rounds, Sum, interpret);
+    auto New = encodesPerSecond(Insts, Rounds, Sum, [](const mc::MCInst& I) {
+      return I.makeEncoding();
+    });
+
+    std::print("{:>6} {:>8} {:>12.2f} M {:>12.2f} M {:>7.1f}x\n",
+               g < Formats.size() ? Formats[g] : "C", Insts.size(), Old / 1e6,
+               New / 1e6, New / Old);
+  }
+
+  std::print("{} mismatches (checksum {:x})\n", Mismatch, Sum);
+
+  /// addi/ld/sd/add/beq/lui/jal and a few others, roughly as in -O2 output,
+  /// in runs of 16 of one opcode
+  const mc::MCOpCode* Mix[] = {
+      &mc::ADDI, &mc::ADDI, &mc::ADDI, &mc::LD,   &mc::LD,  &mc::SD,
+      &mc::ADD,  &mc::ADDW, &mc::SUB,  &mc::ADDIW, &mc::BEQ, &mc::BNE,
+      &mc::LUI,  &mc::AUIPC, &mc::JAL, &mc::JALR, &mc::SLLI, &mc::MUL};
+
+  std::deque<mc::MCInst> Text;
+  mc::MCInstStore Store;
+  for (std::size_t i = 0; i < (1u << 20); ++i) {
+    const auto& Op = *Mix[(i / 16 * 7919) % std::size(Mix)];
+    mc::MCEncoder E(Op);
+
+    mc::MCInst Inst(&Op);
+    Store.push(Op, i * 4, 0);
+    for (unsigned r = 0; r < E.RegsNeeded; ++r) {
+      Inst.addOperand(mc::MCOperand::makeReg((i + r * 5) % 32));
+      Store.addReg((i + r * 5) % 32);
+    }
+    if (E.NumImms) {
+      Inst.addOperand(mc::MCOperand::makeImm(static_cast<int64_t>(i % 8) * 2));
+      Store.addImm(i % 8 * 2);
+    }
+    Text.push_back(std::move(Inst));
+  }
+
+  std::vector<uint8_t> Single(Text.size() * 4), Batch(Text.size() * 4);
+  constexpr unsigned Rounds = 8;
+
+  auto Begin = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < Rounds; ++r) {
+    auto* Out = Single.data();
+    for (const auto& Inst : Text) {
+      auto Bits = Inst.makeEncoding();
+      std::memcpy(Out, &Bits, 4);
+      Out += 4;
+    }
+  }
+  std::chrono::duration<double> SingleTime =
+      std::chrono::steady_clock::now() - Begin;
+
+  Begin = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < Rounds; ++r) {
+    mc::encodeText(Store, Batch.data());
+  }
+  std::chrono::duration<double> BatchTime =
+      std::chrono::steady_clock::now() - Begin;
+
+  auto Total = static_cast<double>(Text.size()) * Rounds;
+  bool SameText = Single == Batch;
+
+  std::print("\n.text of {} insts\n", Text.size());
+  std::print("inst by inst: {:10.2f} M encodes/s\n",
+             Total / SingleTime.count() / 1e6);
+  std::print("encodeText  : {:10.2f} M encodes/s ({:.1f}x), {}\n",
+             Total / BatchTime.count() / 1e6,
+             SingleTime.count() / BatchTime.count(),
+             SameText ? "same bytes" : "DIFFERENT bytes");
+
+  Mismatch += !SameText;
+
+  return Mismatch ? 1 : 0;
+}
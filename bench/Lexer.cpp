@@ -0,0 +1,98 @@
+#include "parser/Lexer.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include "utils/source.hpp"
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <print>
+#include <string>
+
+/// usage: bench_lexer [file.s]
+///
+/// tokenizes the input (or ~64MB of synthetic compiler output) until
+/// END_OF_FILE and reports the lexer throughput, parsing is not involved
+
+using StringRef = utils::ADT::StringRef;
+
+namespace {
+
+/// compiler output style: indented instructions, labels, directives, comments
+std::string synthesize(std::size_t Bytes) {
+  static constexpr const char* Lines[] = {
+      "\t.text\n",
+      "\t.globl\tmain                            # -- Begin function main\n",
+      "main:                                   # @main\n",
+      "# %bb.0:\n",
+      "\taddi\tsp, sp, -32\n",
+      "\tsd\tra, 24(sp)                      # 8-byte Folded Spill\n",
+      "\tsd\ts0, 16(sp)                      # 8-byte Folded Spill\n",
+      "\taddi\ts0, sp, 32\n",
+      ".LBB0_1:                                # =>This Inner Loop Header\n",
+      "\tlui\ta0, %hi(counter)\n",
+      "\tlw\ta1, %lo(counter)(a0)\n",
+      "\taddiw\ta1, a1, 1\n",
+      "\tbne\ta1, a2, .LBB0_1\n",
+      "\tc.addi\tA0, 0x10\n",
+      "\tld\tra, 24(sp)                      # 8-byte Folded Reload\n",
+      "\tret\n",
+      "\t.data\n",
+      "counter_table_entry_0123456789:\n",
+      "\t.word\t1234567\n",
+  };
+
+  std::string Source;
+  Source.reserve(Bytes + 128);
+  while (Source.size() < Bytes) {
+    for (const auto* Line : Lines) {
+      Source += Line;
+    }
+  }
+  return Source;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::optional<utils::SourceBuffer> File;
+  std::string Synthetic;
+  StringRef Source;
+
+  if (argc > 1) {
+    File.emplace(utils::SourceBuffer::open(argv[1]));
+    Source = File->getBuffer();
+  } else {
+    Synthetic = synthesize(64u << 20);
+    Source = StringRef(Synthetic);
+  }
+
+  if (Source.empty()) {
+    std::print("empty input\n");
+    return 1;
+  }
+
+  /// at least ~256MB lexed in total
+  unsigned Rounds = static_cast<unsigned>((256u << 20) / Source.size()) + 1;
+
+  std::size_t Tokens = 0;
+  auto Begin = std::chrono::steady_clock::now();
+
+  for (unsigned r = 0; r < Rounds; ++r) {
+    auto Lexer = parser::Lexer(Source);
+    for (auto Tok = Lexer.nextToken(); Tok.type != parser::TokenType::END_OF_FILE;
+         Tok = Lexer.nextToken()) {
+      ++Tokens;
+    }
+  }
+
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Begin;
+
+  auto Bytes = static_cast<double>(Source.size()) * Rounds;
+
+  std::print("{} bytes x {} rounds, {} tokens per round\n", Source.size(),
+             Rounds, Tokens / Rounds);
+  std::print("lexer: {:10.2f} MB/s, {:10.2f} M tokens/s\n",
+             Bytes / Elapsed.count() / 1e6, Tokens / Elapsed.count() / 1e6);
+
+  return 0;
+}
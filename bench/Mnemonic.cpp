@@ -0,0 +1,133 @@
+#include "mc/MCOpCode.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/// usage: bench_mnemonic [file.s]
+///
+/// replays the first word of every line of the input (or a synthetic mix of
+/// mnemonics and labels) through the former linear scan and the perfect hash,
+/// the same way Lexer::scanIdentifier queries every identifier
+
+using StringRef = utils::ADT::StringRef;
+
+namespace {
+
+/// what MnemonicFind did before: lowercase a copy, then walk every entry
+const mc::MCOpCode* linearFind(StringRef Mnemonic) {
+  std::string Lower = Mnemonic.str();
+  for (auto& c : Lower) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+
+  for (std::size_t i = 0; i < parser::MnemonicCnt; ++i) {
+    if (parser::MnemonicKeys[i].str() == StringRef(Lower)) {
+      return parser::MnemonicOpCodes[i];
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename Fn>
+double lookupsPerSecond(const std::vector<StringRef>& Words, unsigned Rounds,
+                        std::size_t& Hits, Fn&& Find) {
+  auto Begin = std::chrono::steady_clock::now();
+
+  for (unsigned r = 0; r < Rounds; ++r) {
+    for (const auto& Word : Words) {
+      Hits += Find(Word) != nullptr;
+    }
+  }
+
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Begin;
+
+  return static_cast<double>(Words.size()) * Rounds / Elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  std::string Source;
+  std::vector<std::string> Pool;
+  std::vector<StringRef> Words;
+
+  if (argc > 1) {
+    std::ifstream File(argv[1], std::ios::binary);
+    std::stringstream Buffer;
+    Buffer << File.rdbuf();
+    Source = Buffer.str();
+
+    auto isBlank = [](char c) { return c == ' ' || c == '\t'; };
+    auto isIdent = [](char c) {
+      return std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+             c == '.';
+    };
+
+    StringRef Src(Source);
+    std::size_t Cursor = 0;
+    while (Cursor < Src.size()) {
+      while (Cursor < Src.size() && isBlank(Src[Cursor])) {
+        ++Cursor;
+      }
+
+      auto Start = Cursor;
+      while (Cursor < Src.size() && isIdent(Src[Cursor])) {
+        ++Cursor;
+      }
+
+      if (Cursor != Start) {
+        Words.push_back(Src.slice(Start, Cursor));
+      }
+
+      while (Cursor < Src.size() && Src[Cursor] != '\n') {
+        ++Cursor;
+      }
+      ++Cursor;
+    }
+  } else {
+    /// compiler output style: mostly mnemonics, some labels and symbols
+    for (std::size_t i = 0; i < parser::MnemonicCnt; ++i) {
+      auto Key = parser::MnemonicKeys[i].str().str();
+      Pool.push_back(Key);
+      for (auto& c : Key) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+      }
+      Pool.push_back(Key);
+      Pool.push_back(".LBB" + std::to_string(i) + "_" + std::to_string(i % 7));
+    }
+
+    for (std::size_t i = 0; i < (1u << 22); ++i) {
+      Words.push_back(Pool[(i * 7919) % Pool.size()]);
+    }
+  }
+
+  if (Words.empty()) {
+    std::print("no words to look up\n");
+    return 1;
+  }
+
+  unsigned Rounds = Words.size() < (1u << 20) ? (1u << 22) / Words.size() : 1;
+
+  std::size_t LinearHits = 0, HashHits = 0;
+
+  auto Linear = lookupsPerSecond(Words, Rounds, LinearHits, linearFind);
+  auto Hash = lookupsPerSecond(Words, Rounds, HashHits, [](StringRef Word) {
+    return parser::MnemonicFind(Word);
+  });
+
+  std::print("{} lookups x {} rounds, {} hits\n", Words.size(), Rounds,
+             HashHits / Rounds);
+  std::print("linear scan : {:10.2f} M lookups/s\n", Linear / 1e6);
+  std::print("perfect hash: {:10.2f} M lookups/s ({:.1f}x)\n", Hash / 1e6,
+             Hash / Linear);
+
+  return LinearHits == HashHits ? 0 : 1;
+}
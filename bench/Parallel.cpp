@@ -0,0 +1,147 @@
+#include "mc/MCContext.hpp"
+#include "parser/Lexer.hpp"
+#include "parser/Parser.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include "utils/ThreadPool.hpp"
+#include "utils/output.hpp"
+#include "utils/source.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// usage: bench_parallel [-j N] [file.s]
+///
+/// parses the input (or ~64MB of synthetic compiler output) as `mc -c` does
+/// and as `mc -j N -c` does, for N = 2, 4, ... up to N, hardware_concurrency
+/// by default, and reports the wall-clock time of each with how many chunks
+/// were appended and how many parsed again in place. the synthetic input is
+/// .text only, so every chunk should be appended. writein() is the same
+/// for both and not timed
+
+using StringRef = utils::ADT::StringRef;
+
+namespace {
+
+/// compiler output style functions, each calling the one before it, so
+/// chunks refer to labels of the chunks ahead of them
+std::string synthesize(std::size_t Bytes) {
+  std::string Source = ".text\n";
+  Source.reserve(Bytes + 512);
+
+  for (std::size_t i = 0; Source.size() < Bytes; ++i) {
+    std::format_to(std::back_inserter(Source),
+                   ".globl f{0}\n"
+                   "f{0}:\n"
+                   "\taddi sp, sp, -32\n"
+                   "\tsd ra, 24(sp)\n"
+                   "\tsd s0, 16(sp)\n"
+                   "\taddi s0, sp, 32\n"
+                   "f{0}_1:\n"
+                   "\taddiw a1, a1, 1\n"
+                   "\tbne a1, a2, f{0}_1\n"
+                   "\tjal ra, f{1}\n"
+                   "\tld ra, 24(sp)\n"
+                   "\tld s0, 16(sp)\n"
+                   "\taddi sp, sp, 32\n"
+                   "\tjalr x0, 0(ra)\n",
+                   i, i ? i - 1 : 0);
+  }
+  return Source;
+}
+
+/// the best of a few runs, in seconds
+template <typename F> double best(F&& Run) {
+  double Best = 0;
+  for (int r = 0; r < 3; ++r) {
+    auto Begin = std::chrono::steady_clock::now();
+    Run();
+    std::chrono::duration<double> Elapsed =
+        std::chrono::steady_clock::now() - Begin;
+    Best = r ? std::min(Best, Elapsed.count()) : Elapsed.count();
+  }
+  return Best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned Jobs = std::max(std::thread::hardware_concurrency(), 1u);
+  const char* Path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    StringRef Arg(argv[i]);
+    if (Arg == "-j" && i + 1 < argc) {
+      StringRef Num(argv[++i]);
+      auto [ptr, ec] = std::from_chars(Num.begin(), Num.end(), Jobs);
+      if (ec != std::errc{} || ptr != Num.end() || !Jobs) {
+        std::print("expecting a thread count after '-j'\n");
+        return 1;
+      }
+    } else {
+      Path = argv[i];
+    }
+  }
+
+  std::optional<utils::SourceBuffer> File;
+  std::string Synthetic;
+  StringRef Source;
+
+  if (Path) {
+    File.emplace(utils::SourceBuffer::open(Path));
+    Source = File->getBuffer();
+  } else {
+    Synthetic = synthesize(64u << 20);
+    Source = StringRef(Synthetic);
+  }
+
+  auto Null = utils::OutputFile::open("/dev/null");
+
+  auto Serial = best([&] {
+    mc::MCContext Ctx(Null);
+    parser::Lexer Lexer(Source);
+    parser::Parser(Ctx, Lexer).parse();
+  });
+
+  /// a speedup only means something with a core for every thread
+  auto Hardware = std::max(std::thread::hardware_concurrency(), 1u);
+
+  std::print("{} bytes, {} hardware threads\n", Source.size(), Hardware);
+  std::print("-j 1: {:8.3f}s\n", Serial);
+
+  if (Jobs < 2) {
+    std::print("one thread, nothing to compare against\n");
+    return 0;
+  }
+
+  std::vector<unsigned> Counts;
+  for (unsigned N = 2; N < Jobs; N *= 2) {
+    Counts.push_back(N);
+  }
+  Counts.push_back(Jobs);
+
+  for (auto N : Counts) {
+    utils::ThreadPool Pool(N);
+    parser::ParallelStats Stats;
+
+    auto Parallel = best([&] {
+      mc::MCContext Ctx(Null);
+      Stats = parser::parseParallel(Ctx, Source, Pool);
+    });
+
+    std::print("-j {}: {:8.3f}s, {:5.2f}x, {} chunks, {} appended, {} parsed "
+               "again{}\n",
+               N, Parallel, Serial / Parallel, Stats.Chunks,
+               Stats.Chunks - Stats.Reparsed, Stats.Reparsed,
+               N > Hardware ? " (more threads than cores)" : "");
+  }
+
+  return 0;
+}
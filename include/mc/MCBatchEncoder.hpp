@@ -0,0 +1,103 @@
+#ifndef MC_BATCHENCODER
+#define MC_BATCHENCODER
+
+/// encodes all of .text at once.
+/// insts whose pattern has exactly one of the base 32-bit layouts below are
+/// gathered into operand columns per format, and every format runs its
+/// scatter-bit kernel over them, 8 insts per step with AVX2. everything
+/// else (shifts, fence, rm fields, compressed) goes through mc::Encoders
+
+#include "mc/MCEncoder.hpp"
+#include "mc/MCInstStore.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mc {
+
+enum class MCFormat : uint8_t { R, I, S, B, U, J, Other };
+
+inline constexpr std::size_t MCFormatCnt = std::size_t(MCFormat::Other);
+
+/// fields of a format, in the order MCEncoder lists them (lowest bit first)
+struct MCLayout {
+  std::array<MCEncoder::RegField, 3> Regs{};
+  unsigned NumRegs = 0;
+  std::array<MCEncoder::ImmField, 4> Imms{};
+  unsigned NumImms = 0;
+  unsigned ImmBits = 0;
+};
+
+// clang-format off
+inline constexpr MCLayout Layouts[MCFormatCnt] = {
+  /// R: rs2 rs1 funct3 rd opcode
+  {{{{0, 7, 0x1f}, {1, 15, 0x1f}, {2, 20, 0x1f}}}, 3, {}, 0, 0},
+  /// I: imm[11:0] rs1 funct3 rd opcode
+  {{{{0, 7, 0x1f}, {1, 15, 0x1f}}}, 2, {{{0, 20, 0xfff}}}, 1, 12},
+  /// S: imm[11:5] rs2 rs1 funct3 imm[4:0] opcode
+  {{{{0, 15, 0x1f}, {1, 20, 0x1f}}}, 2,
+   {{{0, 7, 0x1f}, {5, 25, 0x7f}}}, 2, 12},
+  /// B: imm[12|10:5] rs2 rs1 funct3 imm[4:1|11] opcode
+  {{{{0, 15, 0x1f}, {1, 20, 0x1f}}}, 2,
+   {{{11, 7, 0x1}, {1, 8, 0xf}, {5, 25, 0x3f}, {12, 31, 0x1}}}, 4, 13},
+  /// U: imm[31:12] rd opcode
+  {{{{0, 7, 0x1f}}}, 1, {{{12, 12, 0xfffff}}}, 1, 32},
+  /// J: imm[20|10:1|11|19:12] rd opcode
+  {{{{0, 7, 0x1f}}}, 1,
+   {{{12, 12, 0xff}, {11, 20, 0x1}, {1, 21, 0x3ff}, {20, 31, 0x1}}}, 4, 21},
+};
+// clang-format on
+
+constexpr MCFormat formatOf(const MCEncoder& E) {
+  auto sameReg = [](const MCEncoder::RegField& A,
+                    const MCEncoder::RegField& B) {
+    return A.Op == B.Op && A.Shift == B.Shift && A.Mask == B.Mask;
+  };
+  auto sameImm = [](const MCEncoder::ImmField& A,
+                    const MCEncoder::ImmField& B) {
+    return A.Low == B.Low && A.Shift == B.Shift && A.Mask == B.Mask;
+  };
+
+  for (std::size_t f = 0; f < MCFormatCnt; ++f) {
+    const auto& L = Layouts[f];
+
+    bool Same = E.Length == 32 && E.NumRegs == L.NumRegs &&
+                E.NumImms == L.NumImms && E.ImmBits == L.ImmBits;
+    for (unsigned i = 0; Same && i < L.NumRegs; ++i) {
+      Same = sameReg(E.Regs[i], L.Regs[i]);
+    }
+    for (unsigned i = 0; Same && i < L.NumImms; ++i) {
+      Same = sameImm(E.Imms[i], L.Imms[i]);
+    }
+
+    if (Same) {
+      return MCFormat(f);
+    }
+  }
+
+  return MCFormat::Other;
+}
+
+struct MCBatchInfo {
+  MCFormat Format;
+  /// bytes in .text, as MCOpCode::isCompressed counts them
+  uint8_t Size;
+  uint32_t Base;
+};
+
+/// indexed by MCOpCode::index
+#define DOIT(op, pattern)                                                      \
+  {formatOf(EncoderOf<op>),                                                    \
+   static_cast<uint8_t>(op.isCompressed() ? 2 : 4), EncoderOf<op>.Base},
+inline constexpr MCBatchInfo BatchInfos[] = {
+#include "RISCV.def"
+};
+#undef DOIT
+
+/// encode Insts back to back into Text, which holds at least the sum of their
+/// sizes. returns the number of bytes written
+std::size_t encodeText(const MCInstStore& Insts, uint8_t* Text);
+
+} // namespace mc
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef MC_COMPRESS
+#define MC_COMPRESS
+
+/// the RVC compression of .option rvc: a 32-bit inst whose registers and imm
+/// fit one of the C forms of RISCV.def is rewritten into it, 2 bytes instead
+/// of 4. the C form does exactly what the 32-bit inst would have
+
+#include "mc/MCInstStore.hpp"
+
+namespace mc {
+
+/// rewrite inst i of Insts into its C form, false if it has none. the imm has
+/// to be final, an inst waiting for a symbol is never passed here
+bool compressInst(MCInstStore& Insts, MCInstStore::Index i);
+
+} // namespace mc
+
+#endif
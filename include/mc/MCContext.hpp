@@ -1,198 +1,497 @@
 #ifndef MC_CONTEXT
 #define MC_CONTEXT
 
+#include "MCCompress.hpp"
 #include "MCExpr.hpp"
-#include "MCInst.hpp"
+#include "MCFixup.hpp"
+#include "MCFragment.hpp"
+#include "MCInstStore.hpp"
 #include "MCOpCode.hpp"
+#include "MCOrdering.hpp"
+#include "MCSection.hpp"
+#include "MCSymbol.hpp"
 #include "utils/ADT/ByteStream.hpp"
 #include "utils/ADT/StringMap.hpp"
 #include "utils/ADT/StringRef.hpp"
 #include "utils/ADT/StringSet.hpp"
+#include "utils/ADT/StringTable.hpp"
 #include "utils/macro.hpp"
+#include "utils/output.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <deque>
 #include <elf.h>
-#include <fstream>
-#include <ostream>
-#include <set>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+namespace utils {
+class ThreadPool;
+} // namespace utils
+
 namespace mc {
 using StringRef = utils::ADT::StringRef;
 template <typename V> using StringMap = utils::ADT::StringMap<V>;
 using StringSet = utils::ADT::StringSet<>;
 using ByteStream = utils::ADT::ByteStream;
+using StringTableBuilder = utils::ADT::StringTableBuilder;
+
+/// what .option sets, saved by .option push
+struct MCOptions {
+  bool RVC = false;   // compress the insts committed from here on
+  bool Relax = false; // leave pc-relative references to the linker
+
+  bool operator==(const MCOptions&) const = default;
+};
 
 class MCContext {
 public:
   using size_ty = std::size_t;
+  using Index = MCInstStore::Index;
+
+  /// an alignment that pads whatever it takes
+  static constexpr size_ty NoMaxSkip = SIZE_MAX;
 
 private:
   /// fs handle
-  std::ostream& file;
-
-  /// inst use symbols, which need gen Elf64_Rela or cul offset(.text)
-  std::set<std::tuple<MCInst*, std::string>> ReloInst;
+  utils::OutputFile& file;
+
+  /// inst use symbols. a label of the same section resolves them, the rest
+  /// need gen Elf64_Rela. appended in inst order, so relocated in offset
+  /// order within each section
+  std::vector<MCFixup> Fixups;
+
+  /// ELF Header, the fields Ehdr_Shdr leaves alone are zero
+  Elf64_Ehdr Elf_Ehdr = {};
+
+  /// every section by id, behind the null one so that an id is its section
+  /// header index. .text, .data and .bss come first, see MCSymbol
+  std::deque<MCSection> Sections;
+  std::unordered_map<std::string_view, uint32_t> SectionIds; // views of Name
+  /// the section the input is in
+  uint32_t Cur = MCSymbol::text;
+
+  /// --function-sections: .text is cut at every label declared .globl
+  /// before it, each function goes into a .text.<label> of its own.
+  /// TextTail is the one .text stands for, the section of the last of them
+  bool FunctionSections = false;
+  uint32_t TextTail = MCSymbol::text;
+
+  /// lay the functions out by it, cutting .text as --function-sections
+  /// does while parsing. the cold ones go behind, or into .text.unlikely
+  /// with SplitCold
+  const MCOrdering* Ordering = nullptr;
+  bool SplitCold = false;
+
+  /// fold the global functions of .text that are the same inst for inst,
+  /// fixup for fixup into one, the others become aliases of it. one that
+  /// runs into the next never folds. .text is cut as for
+  /// --function-sections while parsing. FoldPool hashes them
+  bool FoldFunctions = false;
+  utils::ThreadPool* FoldPool = nullptr;
+
+  /// --align-functions / --align-loops, 0 for none. padded at layout, so
+  /// never while streaming
+  size_ty AlignFunctions = 0;
+  size_ty AlignLoops = 0;
+
+  /// streaming: .text only holds the insts parsed since the last window went
+  /// out, the ones still waiting for a symbol are moved here until writein().
+  /// the other sections are kept whole
+  bool Streaming = false;
+  size_ty StreamedText = 0; // bytes of .text already in the file
+  MCInstStore PendingInsts;
+  std::vector<MCFixup> PendingFixups;
+
+  static constexpr size_ty StreamWindow = size_ty(1) << 16; // insts
+
+  /// .option in effect. a chunk starts with the ones its parent had,
+  /// EntryOptions, and is only appended where those still hold
+  MCOptions Options;
+  MCOptions EntryOptions;
+  /// .option push
+  SmallVector<MCOptions, 4> OptionStack;
+
+  // symbols cross sections, define in any of them, or extern
+  MCSymbolTable Syms;
+
+  /// .symtab, the locals first
+  std::vector<Elf64_Sym> Elf_Syms;
+  size_ty LocalSyms = 0;
 
-  /// buffer
-  // ByteStream<> TextBuffer;
+  /// leave local labels no relocation refers to out of .symtab
+  bool DiscardLocals = false;
 
-  /// ELF Header
-  Elf64_Ehdr Elf_Ehdr;
+  /// .strtab
+  StringTableBuilder StrTab;
 
-  /// .text
-  size_ty TextOffset = 0;
-  StringMap<size_ty> TextLabels;
-  std::deque<MCInst> Insts; // avoid realloction
-  std::deque<MCExpr> Exprs; // avoid realloction
+  /// .shstrtab
+  StringTableBuilder SHStrTab;
 
-  /// .rela.text
+  /// Section Header Table: the sections by id, then .strtab, .symtab, the
+  /// .rela of each text section that has any, .rela.text always, and
+  /// .shstrtab last
+  SmallVector<Elf64_Shdr, 8> Elf_Shdrs;
 
 public:
-  enum NdxSection : uint8_t {
-    text = 1,
-    data,
-    bss,
-    und = 0,
-  };
+  explicit MCContext(utils::OutputFile& _file) : file(_file) {
+    Sections.emplace_back(StringRef(), SHT_NULL, 0);
+    for (auto Name : {".text", ".data", ".bss"}) {
+      auto [Type, Flags] = MCSection::defaultsFor(Name);
+      addSection(Name, Type, Flags);
+    }
+  }
+  MCContext(const MCContext&) = delete;
+  MCContext(MCContext&&) = delete;
+  MCContext& operator=(const MCContext&) = delete;
 
 private:
-  // symbols cross sections, define in .text, .data, .bss
-  std::set<std::pair<std::string, NdxSection>> Symbols;
-  std::vector<Elf64_Rela> Elf_Relas;
+  /// assign .symtab indices, fill .strtab and the relocations with them
+  void mkSymTab();
+
+  /// labels of the same section inline, the rest into its Relas
+  void Relo();
 
-  std::set<std::string> ExternSymbols;
+  /// resolve the imm of the inst of Fixup, offset away from its symbol
+  void reloSym(const MCFixup& Fixup, int64_t offset);
 
-  /// .data
-  StringMap<size_ty> DataVariables;
-  ByteStream DataBuffer;
+  /// resolve Fixup right away if its symbol is a label of its section, else
+  /// thread it into the chain of the symbol
+  void addFixup(MCFixup Fixup);
 
-  /// .bss
-  StringMap<size_ty> BssVariables;
-  size_ty BssSize = 0;
+  /// resolve Fixup against a label of its section at Target
+  void reloTextSym(const MCFixup& Fixup, size_ty Target) {
+    int64_t offset = static_cast<int64_t>(
+        Target - Sections[Fixup.Section].Insts.getOffset(Fixup.Inst));
+    utils_assert(offset % 2 == 0,
+                 "offset in .text should be align to as least 2");
 
-  /// TODO: add .symtab section
-  std::vector<Elf64_Sym> Elf_Syms;
+    reloSym(Fixup, offset);
+  }
 
-  /// .strtab
-  ByteStream StrTabBuffer;
+  /// Sym just became a label in a text section, patch every fixup of that
+  /// section waiting for it. the others become relocations
+  void resolveChain(MCSymbol& Sym);
 
-  /// .shstrtab
-  ByteStream SHStrTabBuffer;
+  /// lay each text section out by its fragments: expand the branches and
+  /// jals whose label is out of their reach, a C form into its 32-bit one
+  /// first, a branch into an inverted one over a jal, and resize the .align
+  /// padding behind them, until every one fits. what a jal cant reach takes
+  /// an auipc+jalr, through t1 unless it links, and that only under relax.
+  /// the insts, labels and fixups move along once it settled
+  void layoutText();
 
-  /// Section Header Table
-  SmallVector<Elf64_Shdr, 8> Elf_Shdrs;
+  /// layoutText() for one section, the insts only. Moved maps the old inst
+  /// indices to the new ones, left empty if no size changed
+  void layoutSection(MCSection& Section, std::vector<Index>& Moved);
 
-public:
-  MCContext(std::ofstream& _file) : file(_file) {}
-  MCContext(const MCContext&) = delete;
-  MCContext(MCContext&&) = delete;
-  MCContext& operator=(const MCContext&) = delete;
+  /// by section id, whether the function is run into by the one before it
+  /// in .text, or by .text itself, as parsed
+  std::vector<bool> fallenInto() const;
 
-private:
-  void mkStrTab();
+  /// see FoldFunctions. the sections of the copies are dropped, their
+  /// symbols move to the one kept at the same offsets
+  void foldText();
 
-  /// .text symbol inline
-  void Relo();
+  /// put the functions in the order of Ordering, or as they are without
+  /// one: with --function-sections their sections, else by moving them back
+  /// into .text, each padded to where it assumed to start. a reference
+  /// between two of them resolves once they share a section. a function
+  /// that runs into the next one never leaves it behind
+  void orderText();
+
+  /// keep the sections of Order, in that order, behind the null one, and
+  /// renumber whatever holds an id. nothing may refer to the ones left out
+  void renumberSections(const std::vector<uint32_t>& Order);
+
+  /// a streamed branch cant grow any more, it has to reach in its short form
+  void checkReach(const MCFixup& Fixup) const;
+
+  /// inst i has the regs and the imm its encoder reads. a label spelled like
+  /// a register, JAL ra, f0, would leave it without its imm
+  static void checkOperands(const MCInstStore& Insts, Index i);
 
-  /// offset of each section
-  StringMap<size_ty> Offsets;
+  uint32_t getReloType(const MCFixup& Fixup) const;
+
+  /// encode and write out the insts of .text. what still waits for a symbol
+  /// is encoded with a zero imm and kept, off its chain
+  void streamText();
+
+  /// overwrite the kept insts in the file once writein() resolved them
+  void patchText();
 
   // elf header & section headers (table)
   void Ehdr_Shdr();
 
 private:
+  MCSection& cur() { return Sections[Cur]; }
+
+  bool cutsText() const {
+    return FunctionSections || Ordering || FoldFunctions;
+  }
+
+  /// make Id current, .text is wherever the last function went
+  void enterSection(uint32_t Id) {
+    Cur = Id == MCSymbol::text ? TextTail : Id;
+  }
+
+  /// a label in .text under --function-sections starts its own section if
+  /// it was declared .globl already, or if Ordering lists it
+  void splitText(StringRef Str);
+
+  /// pad Section to Align bytes, see alignText()
+  void alignSection(MCSection& Section, size_ty Align, bool Relax,
+                    SourceOffset Loc, size_ty MaxSkip = NoMaxSkip);
+
+  /// pads in front of the functions and of the targets of backward
+  /// branches of every text section, for layoutText() to size
+  void autoAlign();
+
+  /// the section of Name, made with Type and Flags if there is none yet
+  uint32_t addSection(StringRef Name, uint32_t Type, uint64_t Flags);
+
+  /// a 32-bit inst is padded to 4 bytes, unless rvc allows 2-byte aligned
+  /// ones as well. under relax the linker may shift it by 2 anyway
+  size_ty instAlign(const MCOpCode& OpCode) const {
+    return Options.RVC || Options.Relax || OpCode.isCompressed() ? 2 : 4;
+  }
+
+  void noteTextAlign(const MCOpCode& OpCode) {
+    auto& Section = cur();
+    Section.AssumedAlign = std::lcm(Section.AssumedAlign, instAlign(OpCode));
+  }
+
   size_ty incTextOffset(bool IsCompressed = false) {
-    return IsCompressed ? TextOffset += 2 : TextOffset += 4;
+    return IsCompressed ? cur().Size += 2 : cur().Size += 4;
   }
 
 public:
   /// build obj file
   void writein();
 
-  bool addTextLabel(StringRef Str) {
-    return this->TextLabels.insert(Str, TextOffset);
+  /// write .text out while parsing, every StreamWindow insts, so memory
+  /// stays bounded by the unresolved references instead of the input. the
+  /// elf header is left as zeros and patched in last, the file has to be
+  /// seekable. call before parsing anything
+  void setStreaming();
+
+  void setDiscardLocals(bool Discard) { DiscardLocals = Discard; }
+
+  void setFunctionSections(bool Enable) { FunctionSections = Enable; }
+
+  /// Order outlives the context, it is shared by every chunk
+  void setOrdering(const MCOrdering* Order, bool Split) {
+    Ordering = Order;
+    SplitCold = Split;
+  }
+
+  /// Pool, if any, must not be running the caller
+  void setFoldFunctions(bool Enable, utils::ThreadPool* Pool = nullptr) {
+    FoldFunctions = Enable;
+    FoldPool = Pool;
   }
 
-  bool addTextLabel(StringRef Str, size_ty offset) {
-    return this->TextLabels.insert(Str, std::move(offset));
+  /// Functions and Loops are powers of two, 0 leaves them be
+  void setAutoAlign(size_ty Functions, size_ty Loops) {
+    AlignFunctions = Functions;
+    AlignLoops = Loops;
   }
 
-  bool addReloSym(StringRef Str, NdxSection ndx) {
-    return this->Symbols.insert({Str.str(), ndx}).second;
+  /// .option rvc / norvc
+  void setRVC(bool Enable) { Options.RVC = Enable; }
+
+  /// .option relax / norelax
+  void setRelax(bool Enable) { Options.Relax = Enable; }
+
+  /// .option push / pop. false for a pop without its push
+  void pushOptions() { OptionStack.push_back(Options); }
+  bool popOptions() {
+    if (OptionStack.empty()) {
+      return false;
+    }
+    Options = OptionStack.back();
+    OptionStack.pop_back();
+    return true;
   }
 
-  bool getTextOffset() const { return TextOffset; }
+  /// .text, .data, .bss, or .section Name without flags: the type and flags
+  /// of a new one follow from its name, see MCSection::defaultsFor
+  void switchSection(StringRef Name) {
+    auto It = SectionIds.find(std::string_view(Name.data(), Name.size()));
+    if (It != SectionIds.end()) {
+      enterSection(It->second);
+      return;
+    }
+
+    auto [Type, Flags] = MCSection::defaultsFor(Name);
+    enterSection(addSection(Name, Type, Flags));
+  }
 
-  size_ty addTextInst(MCInst&& inst) {
+  /// .section Name, "flags", @type. a section keeps what it was made with
+  void switchSection(StringRef Name, uint32_t Type, uint64_t Flags) {
+    enterSection(addSection(Name, Type, Flags));
+  }
 
-    auto newOffset = incTextOffset(inst.isCompressed());
+  MCSection::SectionKind getSectionKind() const { return Sections[Cur].Kind; }
 
-    Insts.push_back(std::move(inst));
+private:
+  /// false if Str is defined already, but where a .globl put a variable
+  bool defineSym(StringRef Str, uint32_t ndx, size_ty Value);
 
-    return newOffset;
+public:
+  /// Str: in the current section, whatever it holds
+  bool addLabel(StringRef Str) {
+    if (cutsText() && Cur == TextTail) {
+      splitText(Str);
+    }
+    return defineSym(Str, Cur, cur().Size);
   }
 
-  MCInst* newTextInst(const StringRef OpCode LIFETIME_BOUND) {
-    this->Insts.emplace_back(MCInst(OpCode));
+  /// .globl Str in the current section, the definition is a label or a
+  /// variable
+  bool addReloSym(StringRef Str) {
+    auto& Sym = Syms.getOrInsert(Str);
+    /// or in an earlier function, once .text is cut
+    utils_assert(!Sym.Defined || Sym.Section == Cur ||
+                     (cutsText() && Cur == TextTail),
+                 "global symbol declared in another section");
+
+    if (Sym.Global) {
+      return false;
+    }
+
+    Sym.Global = true;
+    return true;
+  }
 
-    return &this->Insts.back();
+  /// empty context for a later slice of the same input, see append().
+  /// it shares the file of its parent but never writes to it
+  std::unique_ptr<MCContext> makeChunk() {
+    auto Chunk = std::make_unique<MCContext>(file);
+    Chunk->Options = Chunk->EntryOptions = Options;
+    Chunk->FunctionSections = FunctionSections;
+    Chunk->setOrdering(Ordering, SplitCold);
+    Chunk->FoldFunctions = FoldFunctions;
+    return Chunk;
   }
 
-  size_ty commitTextInst() {
+  /// whether Chunk, parsed from offset 0, stays valid at the current ends.
+  /// the .text of a chunk is the .text here, whichever section that is
+  bool canAppend(const MCContext& Chunk) const;
 
-    auto newOffset = incTextOffset(this->Insts.back().isCompressed());
+  /// move everything parsed into Chunk behind the current contents, section
+  /// by section of the same name
+  void append(MCContext& Chunk);
 
-    return newOffset;
-  }
+  /// open an inst at the end of the current section, behind a c.nop if
+  /// misaligned. its operands are added until commitTextInst()
+  void newTextInst(const MCOpCode* OpCode, SourceOffset Loc) {
+    if (Streaming && Cur == MCSymbol::text &&
+        cur().Insts.size() >= StreamWindow) {
+      streamText();
+    }
 
-  const MCExpr* getTextExpr(std::string Symbol, MCExpr::ExprTy ty,
-                            uint64_t Append = 0) {
-    Exprs.emplace_back(ty, Symbol, Append);
-    return &Exprs.back();
+    noteTextAlign(*OpCode);
+
+    auto& Section = cur();
+    if (Section.Size % instAlign(*OpCode)) {
+      noteTextAlign(C_NOP);
+      Section.Insts.push(C_NOP, Section.Size, Loc);
+      incTextOffset(C_NOP.isCompressed());
+    }
+
+    Section.Insts.push(*OpCode, Section.Size, Loc);
   }
 
-  const MCExpr* getTextExpr(StringRef Symbol, MCExpr::ExprTy ty,
-                            uint64_t Append = 0) {
-    Exprs.emplace_back(ty, Symbol, Append);
-    return &Exprs.back();
+  void addTextReg(MCReg Reg) { cur().Insts.addReg(Reg); }
+  void addTextBaseReg(MCReg Reg) { cur().Insts.addBaseReg(Reg); }
+
+  /// a literal imm of the open inst. lui / auipc are written with the 20-bit
+  /// upper imm, their encoders take imm[31:12] of the full value %hi leaves
+  void addTextImm(int64_t Imm);
+
+  /// the open inst refers to Symbol, under a %modifier if ty is valid.
+  /// resolved right away if it is a label of this section already, else
+  /// its imm stays zero until the fixup is resolved
+  void addTextFixup(StringRef Symbol, MCExpr::ExprTy ty = MCExpr::kInValid,
+                    uint64_t Append = 0);
+
+  /// call / tail Symbol: auipc ra (t1 for tail) and a jalr on it, under one
+  /// R_RISCV_CALL_PLT
+  void addCall(StringRef Symbol, bool Tail, SourceOffset Loc);
+
+  /// .align / .balign / .p2align in a text section, Align bytes, none at
+  /// all if that takes more than MaxSkip. padded with nops right away,
+  /// layoutText() resizes the padding as the code before it grows
+  void alignText(size_ty Align, SourceOffset Loc,
+                 size_ty MaxSkip = NoMaxSkip) {
+    alignSection(cur(), Align, Options.Relax, Loc, MaxSkip);
   }
 
-  void addReloInst(MCInst* inst, std::string label) {
-    ReloInst.emplace(inst, std::move(label));
+  /// close the open inst, in its C form under rvc if it has one. the imm of
+  /// an inst with a fixup may not fit once resolved, it stays 32-bit but
+  /// for a branch or jump, which layoutText() narrows where it reaches
+  size_ty commitTextInst() {
+    auto& Insts = cur().Insts;
+    checkOperands(Insts, Insts.back());
+    if (Options.RVC &&
+        (Fixups.empty() || Fixups.back().Section != Cur ||
+         Fixups.back().Inst != Insts.back())) {
+      compressInst(Insts, Insts.back());
+    }
+    return incTextOffset(Insts.isCompressed(Insts.back()));
   }
 
   template <typename T> size_ty pushDataBuf(T&& Value) {
-    this->DataBuffer << std::forward<T>(Value);
-    return this->DataBuffer.size();
+    auto& Section = cur();
+    utils_assert(Section.Kind == MCSection::kData,
+                 "data outside a data section");
+
+    /// ByteStream aligns scalars to their size
+    Section.noteAlign(sizeof(T));
+    Section.Data << std::forward<T>(Value);
+    return Section.Size = Section.Data.size();
   }
 
   template <size_ty N> size_ty pushDataBuf(char (&Value)[N]) {
-    this->DataBuffer << std::forward<decltype(Value)>(Value);
-    return this->DataBuffer.size();
+    auto& Section = cur();
+    Section.Data << std::forward<decltype(Value)>(Value);
+    return Section.Size = Section.Data.size();
   }
 
   bool addDataVar(StringRef Varibale) {
-    return this->DataVariables.insert(Varibale, this->DataBuffer.size());
+    return defineSym(Varibale, Cur, cur().Size);
   }
 
-  size_ty makeDataBufAlign(size_ty balign) {
-    this->DataBuffer.balignTo(balign);
-    return this->DataBuffer.size();
+  /// Fill up to balign, unless that takes more than MaxSkip. the contents
+  /// still assume balign, whether a chunk pads depends on it
+  size_ty makeDataBufAlign(size_ty balign, uint8_t Fill = 0,
+                           size_ty MaxSkip = NoMaxSkip) {
+    auto& Section = cur();
+    Section.noteAlign(balign);
+    if ((balign - Section.Size % balign) % balign <= MaxSkip) {
+      Section.Data.balignTo(balign, Fill);
+    }
+    return Section.Size = Section.Data.size();
   }
 
-  size_ty pushBssBuf(size_ty size) { return this->BssSize += size; }
+  size_ty pushBssBuf(size_ty size) { return cur().Size += size; }
 
   bool addBssVar(StringRef Varibale) {
-    return this->BssVariables.insert(Varibale, this->BssSize);
+    return defineSym(Varibale, Cur, cur().Size);
   }
 
-  size_ty makeBssBufAlign(size_ty balign) {
-    return this->BssSize += (balign - this->BssSize % balign) % balign;
+  size_ty makeBssBufAlign(size_ty balign, size_ty MaxSkip = NoMaxSkip) {
+    auto& Section = cur();
+    Section.noteAlign(balign);
+    auto Pad = (balign - Section.Size % balign) % balign;
+    return Section.Size += Pad <= MaxSkip ? Pad : 0;
   }
 };
 } // namespace mc
@@ -0,0 +1,184 @@
+#ifndef MC_ENCODER
+#define MC_ENCODER
+
+#include "mc/MCInstStore.hpp"
+#include "mc/MCOpCode.hpp"
+#include "utils/logger.hpp"
+#include "utils/misc.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+
+namespace mc {
+
+/// a RISCV.def pattern lowered at compile time.
+/// the static bits fold into Base, every operand field into a shift/mask,
+/// so encoding is a handful of ALU ops instead of a walk over the EnCodings
+struct MCEncoder {
+  /// ((Regs >> 8 * Op) & Mask) << Shift, Op counts the reg operands of the
+  /// inst, see MCPackedOps
+  struct RegField {
+    uint8_t Op = 0;
+    uint8_t Shift = 0;
+    uint32_t Mask = 0;
+  };
+
+  /// ((Imm >> Low) & Mask) << Shift
+  struct ImmField {
+    uint8_t Low = 0;
+    uint8_t Shift = 0;
+    uint32_t Mask = 0;
+  };
+
+  uint32_t Base = 0;
+  unsigned Length = 0;
+
+  std::array<RegField, 8> Regs{};
+  unsigned NumRegs = 0;
+  unsigned RegsNeeded = 0;
+
+  /// a split imm is checked once against its full width, signed unless the
+  /// fields are uimm or nzuimm
+  std::array<ImmField, 16> Imms{};
+  unsigned NumImms = 0;
+  unsigned ImmBits = 0;
+  bool ImmUnsigned = false;
+
+  constexpr explicit MCEncoder(const MCOpCode& Op) {
+    constexpr auto mask = [](unsigned Width) -> uint32_t {
+      return static_cast<uint32_t>((uint64_t(1) << Width) - 1);
+    };
+
+    /// the encodings are stored from the lowest bit up
+    for (const auto& encode : Op.encodings) {
+      unsigned Slot = 0;
+
+      switch (encode.kind) {
+      case EnCoding::kInvalid:
+        continue;
+      case EnCoding::kStatic:
+        /// unused split slots parse as zero length statics
+        Base |= (*encode.static_pattern & mask(encode.length)) << Length;
+        Length += encode.length;
+        continue;
+      case EnCoding::kRs3:
+      case EnCoding::kRs3_short:
+        ++Slot;
+        [[fallthrough]];
+      case EnCoding::kRs2:
+      case EnCoding::kRs2_short:
+        ++Slot;
+        [[fallthrough]];
+      case EnCoding::kRs1:
+      case EnCoding::kRs1_short:
+        ++Slot;
+        [[fallthrough]];
+      case EnCoding::kRd:
+      case EnCoding::kRd_short: {
+        /// rd is the first reg operand only when the inst has one
+        auto Idx = static_cast<uint8_t>(Slot - (Op.hasRd ? 0 : 1));
+
+        Regs[NumRegs++] = {Idx, static_cast<uint8_t>(Length),
+                           mask(encode.length)};
+        RegsNeeded = std::max(RegsNeeded, Idx + 1u);
+        Length += encode.length;
+        continue;
+      }
+      case EnCoding::kRm:
+      case EnCoding::kMemFence:
+      case EnCoding::kImm:
+      case EnCoding::kNzImm:
+      case EnCoding::kUImm: {
+        ImmBits = std::max(ImmBits, encode.highest + 1);
+        ImmUnsigned = encode.kind == EnCoding::kUImm;
+
+        unsigned Used = 0;
+        for (const auto& Range : *encode.bit_range) {
+          if (Used == encode.length) {
+            break;
+          }
+
+          unsigned Width = Range.first - Range.second + 1;
+          Imms[NumImms++] = {static_cast<uint8_t>(Range.second),
+                             static_cast<uint8_t>(Length), mask(Width)};
+          Length += Width;
+          Used += Width;
+        }
+        continue;
+      }
+      }
+    }
+  }
+};
+
+template <const MCOpCode& Op> inline constexpr MCEncoder EncoderOf{Op};
+
+/// the encoder specialized for Op, every loop below unrolls over constants
+template <const MCOpCode& Op> uint32_t encode(const MCPackedOps& Ops) {
+  static constexpr const MCEncoder& E = EncoderOf<Op>;
+  static_assert(E.Length == 16 || E.Length == 32, "malformed RISCV.def entry");
+  static_assert(E.RegsNeeded <= MCInstStore::MaxRegs, "too many reg operands");
+
+  if (Ops.NumRegs < E.RegsNeeded) {
+    utils::unreachable("cant find the right reg op");
+  }
+
+  uint32_t Bits = E.Base;
+
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((Bits |= ((Ops.Regs >> (8 * E.Regs[I].Op)) & E.Regs[I].Mask)
+              << E.Regs[I].Shift),
+     ...);
+  }(std::make_index_sequence<E.NumRegs>{});
+
+  if constexpr (E.NumImms != 0) {
+    if (!Ops.HasImm) {
+      utils::unreachable("cant find the imm op");
+    }
+
+    uint64_t Imm = Ops.Imm;
+    if constexpr (E.ImmUnsigned) {
+      utils_assert(Imm >> E.ImmBits == 0, "size limit excessed");
+    } else {
+      Imm = utils::signIntCompress(Imm, E.ImmBits);
+    }
+
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+      ((Bits |= static_cast<uint32_t>((Imm >> E.Imms[I].Low) &
+                                      E.Imms[I].Mask)
+                << E.Imms[I].Shift),
+       ...);
+    }(std::make_index_sequence<E.NumImms>{});
+  }
+
+  return Bits;
+}
+
+using MCEncodeFn = uint32_t (*)(const MCPackedOps&);
+
+/// indexed by MCOpCode::index
+#define DOIT(name, pattern) &encode<name>,
+inline constexpr MCEncodeFn Encoders[] = {
+#include "RISCV.def"
+};
+#undef DOIT
+
+/// the operands an inst has to be written with, indexed by MCOpCode::index.
+/// checked when the parser commits an inst, the encoders take them as given
+struct MCOperandsNeeded {
+  uint8_t Regs;
+  bool Imm;
+};
+
+#define DOIT(name, pattern)                                                    \
+  MCOperandsNeeded{static_cast<uint8_t>(EncoderOf<name>.RegsNeeded),           \
+                   EncoderOf<name>.NumImms != 0},
+inline constexpr MCOperandsNeeded OperandsNeeded[] = {
+#include "RISCV.def"
+};
+#undef DOIT
+
+} // namespace mc
+
+#endif
@@ -20,7 +20,8 @@ public:
     kTPREL_ADD,
     kTPREL_HI,
     kTLS_IE_PCREL_HI, // Initial Exec
-    kTLS_GD_PCREL_HI  // Global Dynamic
+    kTLS_GD_PCREL_HI, // Global Dynamic
+    kCALL             // call/tail: an auipc and the jalr right behind it
   };
 
 private:
@@ -68,7 +69,7 @@ inline unsigned getModifierSize(MCExpr::ExprTy mod) {
   using ExprTy = MCExpr::ExprTy;
   switch (mod) {
   case ExprTy::kInValid:
-    utils::unreachable("invalid modifier");
+    utils::fatal("invalid modifier");
   case ExprTy::kLO:
   case ExprTy::kPCREL_LO:
     return 12;
@@ -80,8 +81,10 @@ inline unsigned getModifierSize(MCExpr::ExprTy mod) {
   case ExprTy::kTLS_IE_PCREL_HI:
   case ExprTy::kTLS_GD_PCREL_HI:
     return 20;
+  case ExprTy::kCALL:
+    return 32;
   }
-  utils::unreachable("unknown modifier");
+  utils::fatal("unknown modifier");
   return 0;
 }
 
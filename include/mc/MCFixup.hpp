@@ -0,0 +1,38 @@
+#ifndef MC_FIXUP
+#define MC_FIXUP
+
+#include "MCExpr.hpp"
+#include <cstdint>
+
+namespace mc {
+
+/// an inst whose imm depends on a symbol. recorded while parsing, in the
+/// order of the insts. resolved right away against a known label of its own
+/// section, else threaded into a chain per symbol: defining it there patches
+/// the chain, whatever is left at the end becomes an Elf64_Rela. resolved
+/// ones are kept for branch relaxation, which moves their labels
+struct MCFixup {
+  static constexpr uint32_t None = UINT32_MAX;
+
+  uint32_t Inst; // MCInstStore::Index
+  uint32_t Sym;  // MCSymbolTable id
+  /// the %modifier around the symbol, kInValid for a branch/jump target
+  MCExpr::ExprTy Modifier = MCExpr::kInValid;
+  bool Resolved : 1 = false;
+  /// made under .option relax: the linker may move its label, so it always
+  /// becomes an Elf64_Rela, paired with R_RISCV_RELAX if it has a modifier
+  bool Relax : 1 = false;
+  /// made under .option rvc: a branch or jump on a label of its section
+  /// starts out in its C form at layout, see MCFragment::kNarrow
+  bool RVC : 1 = false;
+  /// the section of Inst. only a label of the same one resolves it here
+  uint16_t Section = 0;
+  uint32_t Next = None; // the fixup before on the same symbol
+  int64_t Addend = 0;
+
+  bool hasModifier() const { return Modifier != MCExpr::kInValid; }
+};
+
+} // namespace mc
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef MC_FRAGMENT
+#define MC_FRAGMENT
+
+/// .text cut where layout may change a size. the parser leaves every inst
+/// at the offset it had then, a fragment only records where it starts and
+/// how long it is, so a size that changes moves the fragments behind it and
+/// nothing else is touched until the insts are laid out once at the end
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mc {
+
+struct MCFragment {
+  enum FragmentKind : uint8_t {
+    kData,      // insts of a fixed size
+    kAlign,     // the nops of an .align, sized by where they land
+    kRelaxable, // a branch or jal, C forms too, expanded when out of reach
+  };
+
+  /// the forms of a kRelaxable, each replaces the inst by the insts listed
+  enum Form : uint8_t {
+    kNarrow,   // the C form of a 32-bit branch or jump under rvc
+    kShort,
+    kWide,     // the 32-bit form of a C branch or jump
+    kOverJal,  // inverted branch over: jal x0
+    kOverCall, // inverted branch over: auipc t1; jalr x0
+    kCall,     // auipc; jalr, in place of a jal
+  };
+
+  FragmentKind Kind;
+  uint32_t Start;      // offset as parsed
+  uint32_t ParsedSize; // size as parsed
+  /// kAlign: index into the .align of the context, kRelaxable: its fixup
+  uint32_t Ref = 0;
+  uint32_t Align = 1; // of a kAlign
+  /// of a kAlign, no padding at all where it would take more
+  uint32_t MaxSkip = UINT32_MAX;
+  Form Shape = kShort;
+  uint32_t Offset = Start; // as laid out
+  uint32_t Size = ParsedSize;
+
+  /// of a form other than kShort, which keeps its ParsedSize
+  static uint32_t sizeOf(Form Shape) {
+    return Shape == kNarrow     ? 2
+           : Shape == kOverCall ? 12
+           : Shape == kWide     ? 4
+                                : 8;
+  }
+
+  /// the jump of the expansion is behind the inverted branch
+  uint32_t jumpAt() const {
+    return Shape == kOverJal || Shape == kOverCall ? 4 : 0;
+  }
+};
+
+/// the fragments of one section in offset order. only the ones layout sizes
+/// are added, the insts between them become kData on the way
+class MCFragmentList {
+  std::vector<MCFragment> Frags;
+
+public:
+  using iterator = std::vector<MCFragment>::iterator;
+  using const_iterator = std::vector<MCFragment>::const_iterator;
+
+  /// Frag behind a kData for what the section grew by since the last one
+  void add(const MCFragment& Frag);
+
+  /// the kData up to End, the size of the section as parsed. a label there
+  /// always has a fragment to belong to
+  void finish(uint32_t End) {
+    add({MCFragment::kData, End, 0});
+  }
+
+  /// where an offset as parsed is laid out. a label between two fragments
+  /// belongs to the later one, it is defined in front of it
+  std::size_t moved(std::size_t Start) const;
+
+  /// lay out the fragments from k on, after the size of k changed. the ones
+  /// in front of it stay where they are
+  void layoutFrom(std::size_t k);
+
+  MCFragment& operator[](std::size_t k) { return Frags[k]; }
+  const MCFragment& operator[](std::size_t k) const { return Frags[k]; }
+
+  std::size_t count() const { return Frags.size(); }
+
+  /// size of the section as laid out, after finish()
+  std::size_t size() const {
+    return Frags.empty() ? 0 : Frags.back().Offset + Frags.back().Size;
+  }
+
+  bool empty() const { return Frags.empty(); }
+
+  iterator begin() { return Frags.begin(); }
+  iterator end() { return Frags.end(); }
+  const_iterator begin() const { return Frags.begin(); }
+  const_iterator end() const { return Frags.end(); }
+};
+
+} // namespace mc
+
+#endif
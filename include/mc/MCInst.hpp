@@ -2,6 +2,7 @@
 #define MC_INST
 
 #include "MCExpr.hpp"
+#include "mc/MCInstStore.hpp"
 #include "mc/MCOpCode.hpp"
 #include "mc/MCOperand.hpp"
 #include "utils/ADT/SmallVector.hpp"
@@ -14,6 +15,7 @@
 namespace mc {
 
 using Location = utils::Location;
+using SourceOffset = utils::SourceOffset;
 
 class MCInst {
 public:
@@ -22,21 +24,23 @@ public:
 private:
   const MCOpCode* OpCode; // MCOpCode will all be static and constepxr
 
-  Location Loc;
+  SourceOffset Loc; // see parser::Lexer::getLocation
   size_ty Offset; // offset from the begin of .text
   SmallVector<MCOperand, 6> Operands;
 
 public:
   explicit MCInst(const StringRef& _OpCode LIFETIME_BOUND)
-      : OpCode(parser::MnemonicFind(_OpCode.c_str())) {}
+      : OpCode(parser::MnemonicFind(_OpCode)) {}
 
-  explicit MCInst(const MCOpCode* _OpCode LIFETIME_BOUND, Location _Loc,
+  explicit MCInst(const MCOpCode* _OpCode LIFETIME_BOUND) : OpCode(_OpCode) {}
+
+  explicit MCInst(const MCOpCode* _OpCode LIFETIME_BOUND, SourceOffset _Loc,
                   size_ty _Offset)
       : OpCode(_OpCode), Loc(_Loc), Offset(_Offset) {}
 
-  explicit MCInst(const StringRef& _OpCode LIFETIME_BOUND, Location _Loc,
+  explicit MCInst(const StringRef& _OpCode LIFETIME_BOUND, SourceOffset _Loc,
                   size_ty _Offset)
-      : OpCode(parser::MnemonicFind(_OpCode.c_str())), Loc(_Loc),
+      : OpCode(parser::MnemonicFind(_OpCode)), Loc(_Loc),
         Offset(_Offset) {}
 
   [[nodiscard]] decltype(Operands)::size_ty getOpSize() const {
@@ -51,7 +55,7 @@ public:
   }
 
   const MCOpCode* getOpCode() const { return OpCode; }
-  utils::Location getLoc() const { return Loc; }
+  SourceOffset getLoc() const { return Loc; }
 
   template <decltype(Operands)::size_ty Idx>
   const MCOperand& getOperand() const {
@@ -60,7 +64,7 @@ public:
     return Operands[Idx];
   }
 
-  bool isCompressed() const { return OpCode->name.begin_with("C."); }
+  bool isCompressed() const { return OpCode->isCompressed(); }
 
   /// allow 20 bits offset
   bool isJmp() const { return OpCode->name.begin_with("J"); }
@@ -79,7 +83,7 @@ public:
 
   size_ty getOffset() const { return Offset; }
   void modifyOffset(size_ty newOffset) { Offset = newOffset; }
-  void modifyLoc(Location newLoc) { Loc = newLoc; }
+  void modifyLoc(SourceOffset newLoc) { Loc = newLoc; }
 
   using const_iter = decltype(Operands)::const_iter;
   using const_rev_iter = decltype(Operands)::const_rev_iter;
@@ -90,23 +94,12 @@ public:
   const_rev_iter rbegin() const { return Operands.rbegin(); }
   const_rev_iter rend() const { return Operands.rend(); }
 
-  void reloSym(int64_t offset);
-
-private:
-  bool hasExpr() const {
-    return std::any_of(Operands.begin(), Operands.end(),
-                       [&](const MCOperand& op) { return op.isExpr(); });
-  }
-
-public:
   const MCOperand* getExprOp() const {
     return std::find_if(Operands.begin(), Operands.end(),
                         [&](const MCOperand& op) { return op.isExpr(); });
   }
 
-  uint32_t getReloType() const;
-
-  constexpr static MCInst makeNop(Location Loc, size_ty Offset) {
+  constexpr static MCInst makeNop(SourceOffset Loc, size_ty Offset) {
     auto nop = MCInst(parser::MnemonicFind("addi"), Loc, Offset);
     nop.addOperand(MCOperand::makeReg(*Registers.find("x0")));
     nop.addOperand(MCOperand::makeReg(*Registers.find("x0")));
@@ -114,40 +107,15 @@ public:
     return nop;
   }
 
-  constexpr static MCInst makeCNop(Location Loc, size_ty Offset) {
+  constexpr static MCInst makeCNop(SourceOffset Loc, size_ty Offset) {
     return MCInst(parser::MnemonicFind("c.nop"), Loc, Offset);
   }
 
-  uint32_t makeEncoding() const;
-
-private:
-  /// 0 = Rd(optional), 1 = Rs1, 2 = Rs2, 3 = Rs3
-  template <unsigned idx> const MCOperand& findRegOp() const {
-    int i = OpCode->hasRd ? 0 : 1;
-    for (auto& op : Operands) {
-      if (!op.isReg()) {
-        continue;
-      }
-
-      if (i == idx) {
-        return op;
-      } else {
-        ++i;
-      }
-    }
-
-    utils::unreachable("cant find the right reg op");
-  }
+  /// the operands as MCInstStore keeps them, an expr is left out
+  MCPackedOps pack() const;
 
-  const MCOperand& findGImmOp() const {
-    // assume that only one immOp in per RV inst
-    for (auto& op : Operands) {
-      if (op.isGImm()) {
-        return op;
-      }
-    }
-    utils::unreachable("cant find the imm op");
-  }
+  /// see mc::Encoders
+  uint32_t makeEncoding() const;
 
   /// TODO: dump(), verify()
 };
@@ -0,0 +1,177 @@
+#ifndef MC_INSTSTORE
+#define MC_INSTSTORE
+
+#include "mc/MCOpCode.hpp"
+#include "mc/MCOperand.hpp"
+#include "utils/macro.hpp"
+#include "utils/source.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mc {
+
+using SourceOffset = utils::SourceOffset;
+
+/// the operands of one inst the way the encoders read them: the reg operands
+/// a byte each in order, and the first imm
+struct MCPackedOps {
+  uint32_t Regs = 0;
+  uint8_t NumRegs = 0;
+  bool HasImm = false;
+  uint64_t Imm = 0;
+};
+
+/// the insts of .text as columns, under 30 bytes an inst where an MCInst
+/// takes well over 100. the parser appends an inst with push() and fills in
+/// its operands while it is the last one
+class MCInstStore {
+public:
+  using size_ty = std::size_t;
+  using Index = uint32_t;
+
+  /// an inst waiting for a symbol holds a zero imm, see MCFixup
+  enum ImmKind : uint8_t {
+    kNone,
+    kImm,
+  };
+
+  static constexpr unsigned MaxRegs = 4;
+
+private:
+  std::vector<uint16_t> OpCodes; // MCOpCode::index
+  std::vector<uint32_t> Regs;
+  std::vector<uint8_t> NumRegs;
+  std::vector<ImmKind> Kinds;
+  std::vector<uint64_t> Imms;
+  std::vector<uint32_t> Offsets; // from the begin of .text
+  std::vector<SourceOffset> Locs;
+
+public:
+  size_ty size() const { return OpCodes.size(); }
+  bool empty() const { return OpCodes.empty(); }
+  Index back() const { return static_cast<Index>(size() - 1); }
+
+  Index push(const MCOpCode& Op, size_ty Offset, SourceOffset Loc) {
+    OpCodes.push_back(Op.index);
+    Regs.push_back(0);
+    NumRegs.push_back(0);
+    Kinds.push_back(kNone);
+    Imms.push_back(0);
+    Offsets.push_back(static_cast<uint32_t>(Offset));
+    Locs.push_back(Loc);
+    return back();
+  }
+
+  /// copy inst i of Other to the end
+  Index push(const MCInstStore& Other, Index i) {
+    OpCodes.push_back(Other.OpCodes[i]);
+    Regs.push_back(Other.Regs[i]);
+    NumRegs.push_back(Other.NumRegs[i]);
+    Kinds.push_back(Other.Kinds[i]);
+    Imms.push_back(Other.Imms[i]);
+    Offsets.push_back(Other.Offsets[i]);
+    Locs.push_back(Other.Locs[i]);
+    return back();
+  }
+
+  /// an inst with its operands complete, for insts the parser never saw
+  Index push(const MCOpCode& Op, const MCPackedOps& Ops, size_ty Offset,
+             SourceOffset Loc) {
+    auto i = push(Op, Offset, Loc);
+    Regs[i] = Ops.Regs;
+    NumRegs[i] = Ops.NumRegs;
+    if (Ops.HasImm) {
+      setImm(i, Ops.Imm);
+    }
+    return i;
+  }
+
+  /// drop every inst, the columns keep their capacity
+  void clear() {
+    OpCodes.clear();
+    Regs.clear();
+    NumRegs.clear();
+    Kinds.clear();
+    Imms.clear();
+    Offsets.clear();
+    Locs.clear();
+  }
+
+  void addReg(MCReg Reg) {
+    utils_assert(NumRegs.back() < MaxRegs, "too many reg operands for an inst");
+    Regs.back() |= static_cast<uint32_t>(Reg) << (8 * NumRegs.back()++);
+  }
+
+  /// the reg of an offset(reg) operand is rs1, the second reg after rd or
+  /// the first without one. a store or amo lists rs2 ahead of it
+  void addBaseReg(MCReg Reg) {
+    utils_assert(NumRegs.back() < MaxRegs, "too many reg operands for an inst");
+    unsigned Slot = getOpCode(back()).hasRd ? 1 : 0;
+    if (NumRegs.back() <= Slot) {
+      return addReg(Reg);
+    }
+
+    auto& Packed = Regs.back();
+    auto Below = (uint32_t(1) << (8 * Slot)) - 1;
+    Packed = (Packed & Below) | static_cast<uint32_t>(Reg) << (8 * Slot) |
+             (Packed & ~Below) << 8;
+    ++NumRegs.back();
+  }
+
+  /// the encoders only read the first imm of an inst
+  void addImm(uint64_t Imm) {
+    if (Kinds.back() == kNone) {
+      Kinds.back() = kImm;
+      Imms.back() = Imm;
+    }
+  }
+
+  const MCOpCode& getOpCode(Index i) const {
+    return *parser::MnemonicOpCodes[OpCodes[i]];
+  }
+
+  bool isCompressed(Index i) const { return getOpCode(i).isCompressed(); }
+
+  size_ty getOffset(Index i) const { return Offsets[i]; }
+  void setOffset(Index i, size_ty Offset) {
+    Offsets[i] = static_cast<uint32_t>(Offset);
+  }
+  SourceOffset getLoc(Index i) const { return Locs[i]; }
+  ImmKind getKind(Index i) const { return Kinds[i]; }
+
+  /// turn inst i into Op, another encoding of the same operation
+  void rewrite(Index i, const MCOpCode& Op, const MCPackedOps& Ops) {
+    OpCodes[i] = Op.index;
+    Regs[i] = Ops.Regs;
+    NumRegs[i] = Ops.NumRegs;
+    Kinds[i] = Ops.HasImm ? kImm : kNone;
+    Imms[i] = Ops.Imm;
+  }
+
+  /// resolve the imm of an inst waiting for a symbol
+  void setImm(Index i, uint64_t Imm) {
+    Kinds[i] = kImm;
+    Imms[i] = Imm;
+  }
+
+  MCPackedOps getOps(Index i) const {
+    return {Regs[i], NumRegs[i], Kinds[i] == kImm, Imms[i]};
+  }
+
+  /// columns, for the batch encoder
+  const std::vector<uint16_t>& opcodes() const { return OpCodes; }
+  const std::vector<uint32_t>& regs() const { return Regs; }
+  const std::vector<uint8_t>& numRegs() const { return NumRegs; }
+  const std::vector<ImmKind>& kinds() const { return Kinds; }
+  const std::vector<uint64_t>& imms() const { return Imms; }
+  const std::vector<uint32_t>& offsets() const { return Offsets; }
+
+  /// move the insts of Other behind these, their offsets rebased onto
+  /// TextBase
+  void append(MCInstStore& Other, size_ty TextBase);
+};
+
+} // namespace mc
+
+#endif
@@ -2,6 +2,7 @@
 #define MC_OPCODE
 
 #include "utils/ADT/SmallVector.hpp"
+#include "utils/ADT/StaticStringMap.hpp"
 #include "utils/ADT/StringRef.hpp"
 #include "utils/ADT/StringSwitch.hpp"
 #include "utils/misc.hpp"
@@ -70,6 +71,13 @@ struct EnCoding {
   std::optional<uint16_t> static_pattern;
 };
 
+/// position of every opcode in RISCV.def, see MCOpCode::index
+enum class OpIndex : uint16_t {
+#define DOIT(name, pattern) name,
+#include "RISCV.def"
+#undef DOIT
+};
+
 struct MCOpCode {
 private:
   constexpr static std::tuple<std::array<std::pair<uint16_t, uint16_t>, 8>,
@@ -115,18 +123,23 @@ private:
 public:
   StringRef name;
 
+  /// into the tables generated from RISCV.def (MnemonicOpCodes, Encoders)
+  uint16_t index = 0;
+
   /// 0 means no imm, 1 means consistent, otherwise imm will be splited
   unsigned imm_distribute = 0;
 
   bool hasRd = false;
 
+  constexpr bool isCompressed() const { return name.begin_with("C_"); }
+
   /// NOTE: for constexpr, std::array need a more
   /// large range than 6 which is more ideal
   std::array<EnCoding, 8> encodings;
 
   /// not sure whether is constexpr
-  constexpr MCOpCode(const char* InstName, const char* Pattern)
-      : name(InstName) {
+  constexpr MCOpCode(const char* InstName, const char* Pattern, OpIndex Index)
+      : name(InstName), index(static_cast<uint16_t>(Index)) {
     /// EG: offset[11:0] rs1[4:0] 011 rd[4:0] 0000011
 
     /// NOTE: for constexpr, std::array need a more
@@ -178,6 +191,15 @@ public:
                            return EnCoding{EnCoding::kImm, length, highest,
                                            bit_range, std::nullopt};
                          })
+              .BeginWith("nzuimm",
+                         [this](const StringRef& Str) -> EnCoding {
+                           ++imm_distribute;
+                           auto [bit_range, length, highest] =
+                               parseBitRange(Str.slice(7, Str.size() - 1));
+
+                           return EnCoding{EnCoding::kUImm, length, highest,
+                                           bit_range, std::nullopt};
+                         })
               .BeginWith("uimm",
                          [this](const StringRef& Str) -> EnCoding {
                            ++imm_distribute;
@@ -186,7 +208,7 @@ public:
                            auto [bit_range, length, highest] =
                                parseBitRange(Str.slice(5, Str.size() - 1));
 
-                           return EnCoding{EnCoding::kImm, length, highest,
+                           return EnCoding{EnCoding::kUImm, length, highest,
                                            bit_range, std::nullopt};
                          })
               .BeginWith("rd_",
@@ -266,7 +288,7 @@ public:
 #define ASM(name, pattern)                                                     \
   inline constexpr char _##name[] = #name;                                     \
   inline constexpr char _##name##_Pattern[] = #pattern;                        \
-  static constexpr MCOpCode name{_##name, _##name##_Pattern};
+  inline constexpr MCOpCode name{_##name, _##name##_Pattern, OpIndex::name};
 
 #define DOIT(name, pattern) ASM(name, pattern)
 #include "RISCV.def"
@@ -276,48 +298,58 @@ public:
 
 namespace parser {
 
-#define MNEMONIC(name) processMnemonic(#name)
+/// mnemonic spelled the way the lexer sees it, eg: C_ADDI -> c.addi
+struct MnemonicKey {
+  std::array<char, 16> Buffer{};
+  std::size_t Length = 0;
+
+  template <size_t N>
+  constexpr MnemonicKey(const char (&Name)[N]) : Length(N - 1) {
+    static_assert(N <= 16, "mnemonic is too long");
+    auto processed = processMnemonic(Name);
+    for (size_t i = 0; i < N; ++i) {
+      Buffer[i] = processed[i];
+    }
+  }
+
+  constexpr StringRef str() const { return StringRef(Buffer.data(), Length); }
+};
 
-/// NOTE: tuple<pair<array<N>, MCOpCode*>, ...>
-/// NOTE: avoid using std::make_tuple(), because of tailing comma
-#define DOIT(name, pattern) std::make_pair(MNEMONIC(name), &mc::name),
-constexpr inline auto MnemonicMap = std::tuple{
+#define DOIT(name, pattern) MnemonicKey(#name),
+constexpr inline MnemonicKey MnemonicKeys[] = {
 #include "RISCV.def"
 };
 #undef DOIT
 
-template <size_t N>
-constexpr bool MnemonicContainImpl(const std::array<char, N>& arr,
-                                   const char* c_str) {
-  for (size_t i = 0; i < N; ++i) {
-    if (arr[i] != c_str[i])
-      return false;
-    if (c_str[i] == '\0')
-      return arr[i] == '\0';
-  }
-  return c_str[N] == '\0';
-}
+#define DOIT(name, pattern) &mc::name,
+constexpr inline const mc::MCOpCode* MnemonicOpCodes[] = {
+#include "RISCV.def"
+};
+#undef DOIT
 
-template <size_t I = 0, typename T>
-constexpr bool MnemonicContain(const T& value) {
-  if constexpr (I < std::tuple_size_v<decltype(MnemonicMap)>) {
-    if (MnemonicContainImpl(std::get<I>(MnemonicMap).first, value)) {
-      return true;
-    }
-    return MnemonicContain<I + 1>(value);
+inline constexpr std::size_t MnemonicCnt = std::size(MnemonicKeys);
+
+/// NOTE: perfect hash keyed on the lowercased mnemonic, built at compile time
+/// lookup is case-insensitive, the lexer never needs to lowercase a copy
+constexpr inline auto MnemonicMap = [] {
+  using Map = utils::ADT::StaticStringMap<const mc::MCOpCode*, MnemonicCnt,
+                                          /*IgnoreCase=*/true>;
+
+  std::array<Map::entry_ty, MnemonicCnt> entries{};
+  for (std::size_t i = 0; i < MnemonicCnt; ++i) {
+    entries[i] = {MnemonicKeys[i].str(), MnemonicOpCodes[i]};
   }
-  return false;
+
+  return Map(entries);
+}();
+
+constexpr bool MnemonicContain(StringRef Mnemonic) {
+  return MnemonicMap.contains(Mnemonic);
 }
 
-template <size_t I = 0, typename T>
-constexpr const mc::MCOpCode* MnemonicFind(const T& value) {
-  if constexpr (I < std::tuple_size_v<decltype(MnemonicMap)>) {
-    if (MnemonicContainImpl(std::get<I>(MnemonicMap).first, value)) {
-      return std::get<I>(MnemonicMap).second;
-    }
-    return MnemonicFind<I + 1>(value);
-  }
-  return nullptr;
+constexpr const mc::MCOpCode* MnemonicFind(StringRef Mnemonic) {
+  auto op = MnemonicMap.find(Mnemonic);
+  return op ? *op : nullptr;
 }
 
 } // namespace parser
@@ -1,15 +1,21 @@
 #ifndef MC_OPERAND
 #define MC_OPERAND
 
+#include "utils/ADT/StaticStringMap.hpp"
 #include "utils/ADT/StringMap.hpp"
 #include "utils/macro.hpp"
 #include "utils/misc.hpp"
 #include <cstdint>
+#include <iterator>
+#include <utility>
 namespace mc {
 
 template <typename V> using StringMap = utils::ADT::StringMap<V>;
+using RegEntry = std::pair<utils::ADT::StringRef, uint8_t>;
 
-inline const StringMap<uint8_t> Registers = {
+/// register spellings, matched case-insensitively.
+/// the lexer interns a register as its position in this table
+inline constexpr RegEntry RegisterEntries[] = {
     {"zero", 0}, {"ra", 1},   {"sp", 2},    {"gp", 3},    {"tp", 4},
     {"t0", 5},   {"t1", 6},   {"t2", 7},    {"s0", 8},    {"fp", 8},
     {"s1", 9},   {"a0", 10},  {"a1", 11},   {"a2", 12},   {"a3", 13},
@@ -37,7 +43,12 @@ inline const StringMap<uint8_t> Registers = {
     {"fs7", 23}, {"fs8", 24}, {"fs9", 25},  {"fs10", 26}, {"fs11", 27},
     {"ft8", 28}, {"ft9", 29}, {"ft10", 30}, {"ft11", 31}};
 
-inline const StringMap<uint8_t> CRegisters = {
+inline constexpr utils::ADT::StaticStringMap<
+    uint8_t, std::size(RegisterEntries), /*IgnoreCase=*/true>
+    Registers{RegisterEntries};
+
+/// rd'/rs1'/rs2' of the compressed formats
+inline constexpr RegEntry CRegisterEntries[] = {
     {"x8", 0},  {"x9", 1},  {"x10", 2}, {"x11", 3}, {"x12", 4}, {"x13", 5},
     {"x14", 6}, {"x15", 7}, {"s0", 0},  {"s1", 1},  {"a0", 2},  {"a1", 3},
     {"a2", 4},  {"a3", 5},  {"a4", 6},  {"a5", 7},  {"f8", 0},  {"f9", 1},
@@ -45,6 +56,10 @@ inline const StringMap<uint8_t> CRegisters = {
     {"fs0", 0}, {"fs1", 1}, {"fa0", 2}, {"fa1", 3}, {"fa2", 4}, {"fa3", 5},
     {"fa4", 6}, {"fa5", 7}};
 
+inline constexpr utils::ADT::StaticStringMap<
+    uint8_t, std::size(CRegisterEntries), /*IgnoreCase=*/true>
+    CRegisters{CRegisterEntries};
+
 inline const StringMap<uint8_t> RoundModes = {
     {"rnz", 000}, {"rtz", 001}, {"rdn", 010}, {"rup", 011}, {"rmm", 100}};
 
@@ -54,6 +69,9 @@ class MCInst;
 
 using MCReg = uint8_t;
 
+/// x8-x15, the registers CRegisters spells
+constexpr bool isCRegister(MCReg Reg) { return Reg >= 8 && Reg < 16; }
+
 class MCOperand {
   friend MCContext;
 
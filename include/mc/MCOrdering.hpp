@@ -0,0 +1,51 @@
+#ifndef MC_ORDERING
+#define MC_ORDERING
+
+/// the order the functions of .text are laid out in, hottest first, from a
+/// symbol ordering file or a sampled profile. a function is a label of
+/// .text declared .globl before it or listed here, up to the next one
+
+#include "utils/ADT/StringRef.hpp"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mc {
+using StringRef = utils::ADT::StringRef;
+
+class MCOrdering {
+  std::deque<std::string> Names; // never moves an element
+  std::unordered_map<std::string_view, uint32_t> Ranks; // views into Names
+
+  /// Name at Rank, the first rank of a name listed twice stays
+  void add(std::string_view Name, uint32_t Rank);
+
+public:
+  /// behind every ranked function, in source order
+  static constexpr uint32_t Cold = UINT32_MAX;
+
+  /// one symbol per line, as for ld --symbol-ordering-file. empty lines and
+  /// lines starting with # are skipped
+  static MCOrdering fromSymbolFile(StringRef Text);
+
+  /// "symbol count" per line, the counts of a symbol listed twice add up.
+  /// ranked by count, a symbol without samples is cold
+  static MCOrdering fromProfile(StringRef Text);
+
+  /// Cold for a symbol that is not listed or has no samples
+  uint32_t rank(StringRef Name) const {
+    auto Iter = Ranks.find(std::string_view(Name.data(), Name.size()));
+    return Iter == Ranks.end() ? Cold : Iter->second;
+  }
+
+  /// a listed label starts a function, even a local or a cold one
+  bool lists(StringRef Name) const {
+    return Ranks.contains(std::string_view(Name.data(), Name.size()));
+  }
+};
+
+} // namespace mc
+
+#endif
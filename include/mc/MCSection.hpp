@@ -0,0 +1,95 @@
+#ifndef MC_SECTION
+#define MC_SECTION
+
+#include "MCFragment.hpp"
+#include "MCInstStore.hpp"
+#include "utils/ADT/ByteStream.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <elf.h>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mc {
+using StringRef = utils::ADT::StringRef;
+
+/// an .align in a text section, the nops at Offset are the padding
+struct MCTextAlign {
+  uint32_t Offset;
+  uint32_t Size;
+  uint32_t Align;
+  /// under relax the padding is Align less 2, wherever it lands, and an
+  /// R_RISCV_ALIGN lets the linker trim it
+  bool Relax;
+  SourceOffset Loc;
+  /// the most padding it may take, else it takes none
+  uint32_t MaxSkip = UINT32_MAX;
+};
+
+/// one section of the object, named by .text, .data, .bss or .section. what
+/// it holds follows from its flags: insts if it is executable, no bytes at
+/// all if it is SHT_NOBITS, data otherwise
+struct MCSection {
+  using size_ty = std::size_t;
+
+  enum SectionKind : uint8_t {
+    kText,
+    kData,
+    kNoBits,
+  };
+
+  std::string Name;
+  uint32_t Type = SHT_PROGBITS;
+  uint64_t Flags = 0;
+  SectionKind Kind = kData;
+
+  /// bytes so far. the data of a kData is in Data, this is kept in step
+  size_ty Size = 0;
+
+  /// kText
+  MCInstStore Insts;
+  /// .align in offset order
+  std::vector<MCTextAlign> Aligns;
+  /// what layoutText() may resize, none when streaming
+  MCFragmentList Frags;
+
+  /// kData
+  utils::ADT::ByteStream Data;
+
+  /// alignment the contents assume about the start of the section, an lcm
+  /// since .align pads to non powers of two. a chunk parsed from offset 0
+  /// can only be appended where it holds
+  size_ty AssumedAlign = 1;
+  /// sh_addralign
+  size_ty MaxAlign = 1;
+
+  /// .rela.<Name>, in offset order. the symbol id of each entry, its index
+  /// is known after mkSymTab
+  std::vector<Elf64_Rela> Relas;
+  std::vector<uint32_t> RelaSyms;
+
+  MCSection(StringRef _Name, uint32_t _Type, uint64_t _Flags)
+      : Name(_Name.str()), Type(_Type), Flags(_Flags),
+        Kind(_Type == SHT_NOBITS            ? kNoBits
+             : (_Flags & SHF_EXECINSTR) != 0 ? kText
+                                             : kData),
+        MaxAlign(Kind == kText ? 2 : 1) {}
+
+  /// contents padded to a multiple of Align from the start. sh_addralign
+  /// only takes a power of two, the largest one dividing Align
+  void noteAlign(size_ty Align) {
+    AssumedAlign = std::lcm(AssumedAlign, Align);
+    MaxAlign = std::max(MaxAlign, Align & (~Align + 1));
+  }
+
+  /// type and flags of a section named without them, by the usual prefixes
+  static std::pair<uint32_t, uint64_t> defaultsFor(StringRef Name);
+};
+
+} // namespace mc
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef MC_SYMBOL
+#define MC_SYMBOL
+
+#include "MCFixup.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mc {
+using StringRef = utils::ADT::StringRef;
+
+/// one name of .symtab: a label, a variable, a .globl or an extern, whichever
+/// came first, and what the rest of the input said about it
+struct MCSymbol {
+  using size_ty = std::size_t;
+
+  /// the sections every context starts with. a section id is its section
+  /// header index, .section adds the ones behind them
+  enum NdxSection : uint32_t {
+    text = 1,
+    data,
+    bss,
+    und = 0,
+  };
+
+  std::string Name;
+  uint32_t Section = und;
+  bool Defined = false;    // label or variable
+  bool Global = false;     // .globl
+  bool Referenced = false; // named by an Elf64_Rela
+  bool Function = false;   // starts a .text.<Name> of its own
+  size_ty Value = 0;       // offset into Section
+  uint32_t SymtabIdx = 0;  // 0 until MCContext::mkSymTab emits it
+  uint32_t FixupChain = MCFixup::None; // the last fixup waiting for it
+
+  bool isLocal() const { return Defined && !Global; }
+};
+
+/// every symbol of a context, a hash lookup by name, iterated in the order
+/// they were first seen. that order is also the id of a symbol
+class MCSymbolTable {
+  std::deque<MCSymbol> Symbols; // never moves an element
+  std::unordered_map<std::string_view, uint32_t> Index; // views into Symbols
+
+public:
+  using iterator = std::deque<MCSymbol>::iterator;
+  using const_iterator = std::deque<MCSymbol>::const_iterator;
+
+  MCSymbolTable() = default;
+  MCSymbolTable(const MCSymbolTable&) = delete;
+  MCSymbolTable& operator=(const MCSymbolTable&) = delete;
+
+  /// id of Name, a new undefined symbol if it is not known yet
+  uint32_t intern(StringRef Name);
+
+  MCSymbol& getOrInsert(StringRef Name) { return Symbols[intern(Name)]; }
+
+  MCSymbol& operator[](uint32_t Id) { return Symbols[Id]; }
+  const MCSymbol& operator[](uint32_t Id) const { return Symbols[Id]; }
+
+  MCSymbol* find(StringRef Name);
+  const MCSymbol* find(StringRef Name) const;
+
+  std::size_t size() const { return Symbols.size(); }
+
+  iterator begin() { return Symbols.begin(); }
+  iterator end() { return Symbols.end(); }
+  const_iterator begin() const { return Symbols.begin(); }
+  const_iterator end() const { return Symbols.end(); }
+};
+
+} // namespace mc
+
+#endif
@@ -3,7 +3,9 @@
 
 #include "mc/MCInst.hpp"
 #include "utils/ADT/StringRef.hpp"
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace parser {
 using StringRef = utils::ADT::StringRef;
@@ -37,34 +39,51 @@ enum class TokenType {
 
 std::string to_string(TokenType type);
 
+class Lexer;
+
+/// tokens borrow their lexeme from the source buffer, which must outlive them
 struct Token {
   TokenType type;
-  std::string lexeme;
-  mc::Location loc;
+  StringRef lexeme;
+  utils::SourceOffset offset;
+  /// INSTRUCTION: index into MnemonicOpCodes
+  /// REGISTER: index into mc::Registers
+  uint16_t id = 0;
 
-  void print() const;
+  void print(const Lexer& lexer) const;
 };
 
 class Lexer {
 public:
   Lexer(StringRef source);
+  /// lex source[begin, end) while keeping offsets relative to source
+  Lexer(StringRef source, std::size_t begin, std::size_t end);
 
   Token nextToken();
 
+  /// line/column of a token or inst offset, for diagnostics only.
+  /// the newline index is built on the first call
+  mc::Location getLocation(utils::SourceOffset offset) const;
+
 private:
   StringRef m_source;
   std::size_t m_cursor = 0;
-  std::size_t m_line = 1;
-  std::size_t m_col = 1;
+
+  /// sorted offsets of every '\n' in m_source
+  mutable std::vector<utils::SourceOffset> m_newlines;
+  mutable bool m_indexed = false;
 
   bool isAtEnd() const;
   char advance();
   char peek() const;
   char peekNext() const;
 
+  /// move the cursor to a position returned by the scan:: kernels
+  void skipTo(const char* pos);
+
   void skipWhitespaceAndComments();
   Token makeToken(TokenType type) const;
-  Token makeToken(TokenType type, StringRef lexeme) const;
+  Token makeToken(TokenType type, StringRef lexeme, uint16_t id = 0) const;
   Token errorToken(const char* message) const;
 
   Token scanIdentifier();
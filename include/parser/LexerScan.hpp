@@ -0,0 +1,205 @@
+#ifndef PARSER_LEXERSCAN
+#define PARSER_LEXERSCAN
+
+/// character-class scanning kernels of the lexer.
+/// each kernel returns the first position in [Cur, End) whose byte is not in
+/// its class, classifying 32 (AVX2) or 16 (SSE2) bytes per step and finishing
+/// the tail byte by byte, so nothing past End is ever read
+
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace parser {
+namespace scan {
+
+namespace detail {
+
+constexpr bool inRange(char c, char Lo, char Hi) { return c >= Lo && c <= Hi; }
+
+#if defined(__SSE2__)
+/// all ranges used here are 7-bit, so signed compares are fine
+inline __m128i inRange(__m128i v, char Lo, char Hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(Lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(Hi + 1), v));
+}
+inline __m128i isChar(__m128i v, char c) {
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i inRange(__m256i v, char Lo, char Hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(Lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(Hi + 1), v));
+}
+inline __m256i isChar(__m256i v, char c) {
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+#endif
+
+template <typename Class>
+inline const char* skip(const char* Cur, const char* End) {
+  /// most runs in compiler output end within a byte or two
+  if (Cur != End && !Class::match(*Cur)) {
+    return Cur;
+  }
+
+#if defined(__AVX2__)
+  while (End - Cur >= 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Cur));
+    auto Mask = ~static_cast<unsigned>(_mm256_movemask_epi8(Class::match(v)));
+    if (Mask) {
+      return Cur + __builtin_ctz(Mask);
+    }
+    Cur += 32;
+  }
+#endif
+
+#if defined(__SSE2__)
+  while (End - Cur >= 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Cur));
+    auto Mask = ~static_cast<unsigned>(_mm_movemask_epi8(Class::match(v))) &
+                0xffffu;
+    if (Mask) {
+      return Cur + __builtin_ctz(Mask);
+    }
+    Cur += 16;
+  }
+#endif
+
+  while (Cur != End && Class::match(*Cur)) {
+    ++Cur;
+  }
+  return Cur;
+}
+
+/// ' ', '\t', '\r'
+struct Blank {
+  static constexpr bool match(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+#if defined(__SSE2__)
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(_mm_or_si128(isChar(v, ' '), isChar(v, '\t')),
+                        isChar(v, '\r'));
+  }
+#endif
+#if defined(__AVX2__)
+  static __m256i match(__m256i v) {
+    return _mm256_or_si256(_mm256_or_si256(isChar(v, ' '), isChar(v, '\t')),
+                           isChar(v, '\r'));
+  }
+#endif
+};
+
+/// everything but '\n'
+struct NotNewline {
+  static constexpr bool match(char c) { return c != '\n'; }
+#if defined(__SSE2__)
+  static __m128i match(__m128i v) {
+    return _mm_xor_si128(isChar(v, '\n'), _mm_set1_epi8(-1));
+  }
+#endif
+#if defined(__AVX2__)
+  static __m256i match(__m256i v) {
+    return _mm256_xor_si256(isChar(v, '\n'), _mm256_set1_epi8(-1));
+  }
+#endif
+};
+
+/// [0-9A-Za-z_], plus '.' when WithDot
+template <bool WithDot> struct Word {
+  static constexpr bool match(char c) {
+    return inRange(c, '0', '9') || inRange(c, 'a', 'z') ||
+           inRange(c, 'A', 'Z') || c == '_' || (WithDot && c == '.');
+  }
+#if defined(__SSE2__)
+  static __m128i match(__m128i v) {
+    /// folding 'A'-'Z' onto 'a'-'z' keeps the letter test to one range
+    auto Letter = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    auto m = _mm_or_si128(_mm_or_si128(inRange(v, '0', '9'), Letter),
+                          isChar(v, '_'));
+    return WithDot ? _mm_or_si128(m, isChar(v, '.')) : m;
+  }
+#endif
+#if defined(__AVX2__)
+  static __m256i match(__m256i v) {
+    auto Letter =
+        inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    auto m = _mm256_or_si256(_mm256_or_si256(inRange(v, '0', '9'), Letter),
+                             isChar(v, '_'));
+    return WithDot ? _mm256_or_si256(m, isChar(v, '.')) : m;
+  }
+#endif
+};
+
+/// [0-9]
+struct Digit {
+  static constexpr bool match(char c) { return inRange(c, '0', '9'); }
+#if defined(__SSE2__)
+  static __m128i match(__m128i v) { return inRange(v, '0', '9'); }
+#endif
+#if defined(__AVX2__)
+  static __m256i match(__m256i v) { return inRange(v, '0', '9'); }
+#endif
+};
+
+/// [0-9A-Fa-f]
+struct HexDigit {
+  static constexpr bool match(char c) {
+    return inRange(c, '0', '9') || inRange(c, 'a', 'f') ||
+           inRange(c, 'A', 'F');
+  }
+#if defined(__SSE2__)
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(
+        inRange(v, '0', '9'),
+        inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'f'));
+  }
+#endif
+#if defined(__AVX2__)
+  static __m256i match(__m256i v) {
+    return _mm256_or_si256(
+        inRange(v, '0', '9'),
+        inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'f'));
+  }
+#endif
+};
+
+} // namespace detail
+
+/// spaces, tabs and carriage returns
+inline const char* skipBlanks(const char* Cur, const char* End) {
+  return detail::skip<detail::Blank>(Cur, End);
+}
+
+/// position of the next '\n', or End
+inline const char* findNewline(const char* Cur, const char* End) {
+  return detail::skip<detail::NotNewline>(Cur, End);
+}
+
+/// identifier tail: labels, symbols, mnemonics such as c.addi
+inline const char* skipIdentifier(const char* Cur, const char* End) {
+  return detail::skip<detail::Word<true>>(Cur, End);
+}
+
+/// directive tail, stops at '.'
+inline const char* skipDirective(const char* Cur, const char* End) {
+  return detail::skip<detail::Word<false>>(Cur, End);
+}
+
+inline const char* skipDigits(const char* Cur, const char* End) {
+  return detail::skip<detail::Digit>(Cur, End);
+}
+
+inline const char* skipHexDigits(const char* Cur, const char* End) {
+  return detail::skip<detail::HexDigit>(Cur, End);
+}
+
+} // namespace scan
+} // namespace parser
+
+#endif
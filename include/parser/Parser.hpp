@@ -6,6 +6,11 @@
 #include "mc/MCOpCode.hpp"
 #include "utils/ADT/StringMap.hpp"
 #include "utils/macro.hpp"
+
+namespace utils {
+class ThreadPool;
+}
+
 namespace parser {
 
 template <typename V> using StringMap = utils::ADT::StringMap<V>;
@@ -15,15 +20,28 @@ private:
   mc::MCContext& ctx;
   Lexer& lexer;
 
-  /// speed up mnemnoic class find
-  StringMap<const mc::MCOpCode*> CacheLookUpTab;
+  /// section in effect before the first section directive, empty if none
+  StringRef EntrySection;
+  /// last section directive seen by parse()
+  StringRef ExitSection;
+  /// the input relied on EntrySection before switching sections
+  bool EntryUsed = false;
+  /// EntrySection is a guess, stop instead of failing on a wrong one
+  bool Speculative = false;
+  bool Abandoned = false;
 
 public:
-  Parser(mc::MCContext& _ctx LIFETIME_BOUND, Lexer& _lexer LIFETIME_BOUND)
-      : ctx(_ctx), lexer(_lexer) {}
+  Parser(mc::MCContext& _ctx LIFETIME_BOUND, Lexer& _lexer LIFETIME_BOUND,
+         StringRef _EntrySection = StringRef(), bool _Speculative = false)
+      : ctx(_ctx), lexer(_lexer), EntrySection(_EntrySection),
+        Speculative(_Speculative) {}
 
   void parse();
 
+  StringRef getExitSection() const { return ExitSection; }
+  bool usedEntrySection() const { return EntryUsed; }
+  bool abandoned() const { return Abandoned; }
+
   ~Parser() = default;
 
 private:
@@ -31,6 +49,21 @@ private:
   const mc::MCOpCode* findOpCode(StringRef mnemonic);
 };
 
+/// the chunks parseParallel cut the input into, Reparsed of them were parsed
+/// again in place instead of appended
+struct ParallelStats {
+  std::size_t Chunks = 0;
+  std::size_t Reparsed = 0;
+};
+
+/// parse Source into ctx on Pool: the buffer is cut at newlines outside
+/// string literals, every chunk is parsed into its own context assuming it
+/// starts in .text at offset 0, and the chunks are appended in order.
+/// a chunk whose assumptions do not hold is parsed again in place
+ParallelStats parseParallel(mc::MCContext& ctx, StringRef Source,
+                            utils::ThreadPool& Pool,
+                            std::size_t MinChunkSize = std::size_t(1) << 20);
+
 } // namespace parser
 
 #endif
\ No newline at end of file
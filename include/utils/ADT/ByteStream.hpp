@@ -19,11 +19,11 @@ struct ByteStream {
 
   size_ty size() const { return buffer.size(); }
 
-  void balignTo(size_ty balign) {
+  void balignTo(size_ty balign, uint8_t Fill = 0) {
     auto paddingSize = (balign - (buffer.size() % balign)) % balign;
 
     for (auto i = 0ull; i < paddingSize; ++i) {
-      buffer.push_back('\x00');
+      buffer.push_back(static_cast<char>(Fill));
     }
   }
 
@@ -54,10 +54,11 @@ struct ByteStream {
     return *this;
   }
 
-  /// for .strtab / .shstrtab
-  size_ty findOffset(StringRef Str) const;
-
-  bool hasSym(StringRef Str) const;
+  /// raw bytes of Other, no alignment. not an operator<< since the POD
+  /// overload above would take a non-const ByteStream by reference
+  void append(const ByteStream& Other) {
+    buffer.insert(buffer.end(), Other.buffer.begin(), Other.buffer.end());
+  }
 
   /// for debug
   void dump() const;
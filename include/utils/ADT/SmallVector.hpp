@@ -133,7 +133,7 @@ protected:
   /// check a memref in range or not
   bool isRefOfRange(const void* V, const void* Fir, const void* Last) const {
     std::less<const void*> LessThan;
-    return !LessThan(Fir, V) && LessThan(Fir, Last); // Last serve as sentinel
+    return !LessThan(V, Fir) && LessThan(V, Last); // Last serve as sentinel
   }
   /// check a memref as vec or not
   bool isRefOfStorage(const void* V) const {
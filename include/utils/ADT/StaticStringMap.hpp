@@ -0,0 +1,189 @@
+#ifndef UTILS_ADT_STATICSTRINGMAP
+#define UTILS_ADT_STATICSTRINGMAP
+
+#include "StringRef.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace utils {
+namespace ADT {
+
+/// perfect hash map over a fixed key set, built at compile time with
+/// "hash and displace": keys are first distributed into buckets, then every
+/// bucket searches for a seed that sends all of its keys to free slots.
+/// lookup is one pass over the key, two multiplies and a single compare
+template <typename V, std::size_t N, bool IgnoreCase = false>
+class StaticStringMap {
+public:
+  using size_ty = std::size_t;
+  using value_ty = V;
+  using entry_ty = std::pair<StringRef, V>;
+
+private:
+  static constexpr size_ty ceilPow2(size_ty x) {
+    size_ty p = 1;
+    while (p < x) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  /// load factor < 0.5 keeps the seed search short
+  static constexpr size_ty NumSlots = ceilPow2(2 * N + 1);
+  static constexpr size_ty NumBuckets = ceilPow2(N / 4 + 1);
+  static constexpr uint16_t EmptySlot = 0xffff;
+
+  static_assert(N < EmptySlot, "too many keys for a StaticStringMap");
+
+  std::array<StringRef, N> Keys{};
+  std::array<V, N> Values{};
+  std::array<uint32_t, NumBuckets> Seeds{};
+  std::array<uint16_t, NumSlots> Slots{};
+
+  static constexpr char fold(char c) {
+    if constexpr (IgnoreCase) {
+      return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    } else {
+      return c;
+    }
+  }
+
+  /// FNV-1a, case folded on the fly so that callers never copy the key
+  static constexpr uint64_t hash(StringRef Key) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_ty i = 0; i < Key.size(); ++i) {
+      h ^= static_cast<unsigned char>(fold(Key.data()[i]));
+      h *= 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  static constexpr size_ty bucketOf(uint64_t h) {
+    return (h >> 40) & (NumBuckets - 1);
+  }
+
+  /// splitmix64 finalizer
+  static constexpr size_ty slotOf(uint64_t h, uint32_t seed) {
+    h ^= static_cast<uint64_t>(seed) * 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h & (NumSlots - 1);
+  }
+
+  static constexpr bool equal(StringRef Stored, StringRef Key) {
+    if (Stored.size() != Key.size()) {
+      return false;
+    }
+    for (size_ty i = 0; i < Key.size(); ++i) {
+      if (Stored.data()[i] != fold(Key.data()[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  /// keys are expected to be already folded when IgnoreCase is set
+  constexpr StaticStringMap(const std::array<entry_ty, N>& Entries) {
+    std::array<uint64_t, N> Hashes{};
+    std::array<size_ty, NumBuckets> BucketSize{};
+
+    for (size_ty i = 0; i < N; ++i) {
+      Keys[i] = StringRef(Entries[i].first);
+      Values[i] = Entries[i].second;
+      Hashes[i] = hash(Keys[i]);
+      ++BucketSize[bucketOf(Hashes[i])];
+    }
+
+    for (auto& Slot : Slots) {
+      Slot = EmptySlot;
+    }
+
+    /// place the crowded buckets first, while the table is still sparse
+    std::array<size_ty, NumBuckets> Order{};
+    for (size_ty i = 0; i < NumBuckets; ++i) {
+      Order[i] = i;
+    }
+    for (size_ty i = 0; i < NumBuckets; ++i) {
+      for (size_ty j = i + 1; j < NumBuckets; ++j) {
+        if (BucketSize[Order[j]] > BucketSize[Order[i]]) {
+          std::swap(Order[i], Order[j]);
+        }
+      }
+    }
+
+    for (auto Bucket : Order) {
+      if (!BucketSize[Bucket]) {
+        break;
+      }
+
+      std::array<size_ty, N> Members{};
+      size_ty MemberCnt = 0;
+      for (size_ty i = 0; i < N; ++i) {
+        if (bucketOf(Hashes[i]) == Bucket) {
+          Members[MemberCnt++] = i;
+        }
+      }
+
+      for (uint32_t Seed = 1;; ++Seed) {
+        std::array<size_ty, N> Picked{};
+        bool Fit = true;
+
+        for (size_ty m = 0; m < MemberCnt && Fit; ++m) {
+          auto Slot = slotOf(Hashes[Members[m]], Seed);
+          Fit = Slots[Slot] == EmptySlot;
+          for (size_ty k = 0; k < m && Fit; ++k) {
+            Fit = Picked[k] != Slot;
+          }
+          Picked[m] = Slot;
+        }
+
+        if (Fit) {
+          Seeds[Bucket] = Seed;
+          for (size_ty m = 0; m < MemberCnt; ++m) {
+            Slots[Picked[m]] = static_cast<uint16_t>(Members[m]);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  constexpr StaticStringMap(const entry_ty (&Entries)[N])
+      : StaticStringMap(std::to_array(Entries)) {}
+
+  /// index of Key in the entries the map was built from
+  constexpr std::optional<size_ty> position(StringRef Key) const {
+    auto h = hash(Key);
+    auto Idx = Slots[slotOf(h, Seeds[bucketOf(h)])];
+
+    if (Idx == EmptySlot || !equal(Keys[Idx], Key)) {
+      return std::nullopt;
+    }
+
+    return Idx;
+  }
+
+  constexpr const V* find(StringRef Key) const {
+    auto Pos = position(Key);
+    return Pos ? &Values[*Pos] : nullptr;
+  }
+
+  constexpr bool contains(StringRef Key) const {
+    return position(Key).has_value();
+  }
+
+  constexpr size_ty size() const { return N; }
+
+  constexpr const std::array<StringRef, N>& keys() const { return Keys; }
+  constexpr const std::array<V, N>& values() const { return Values; }
+};
+
+} // namespace ADT
+} // namespace utils
+
+#endif
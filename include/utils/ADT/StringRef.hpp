@@ -125,14 +125,14 @@ public:
     return data()[size() - 1];
   }
 
-  /// c-style char array
+  /// c-style char array, N counts the trailing '\0'
   template <std::size_t N>
   [[nodiscard]] bool operator==(const char (&Array)[N]) const {
-    if (this->size() != N) {
+    if (this->size() != N - 1) {
       return false;
     }
 
-    return !utils::memcmp(this->data(), Array, N);
+    return !utils::memcmp(this->data(), Array, N - 1);
   }
 
   /// check if the String the same
@@ -132,7 +132,7 @@ public:
 
   T Error() {
     if (!Result) {
-      utils::unreachable("StringSwitch::Error: unreachable condicate");
+      utils::fatal("StringSwitch::Error: unreachable condicate");
     }
 
     return std::move(*Result);
@@ -140,7 +140,7 @@ public:
 
   T Error(std::string_view message) {
     if (!Result) {
-      utils::unreachable(message);
+      utils::fatal(message);
     }
 
     return std::move(*Result);
@@ -0,0 +1,55 @@
+#ifndef UTILS_ADT_STRINGTABLE
+#define UTILS_ADT_STRINGTABLE
+
+#include "StringRef.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace utils {
+namespace ADT {
+
+/// builder of an elf string table (.strtab, .shstrtab).
+/// add() every string once or many times, finalize() lays them out, then
+/// getOffset() is a hash lookup. with TailMerge a string that ends another
+/// one, foo in bar_foo, points into it instead of taking bytes of its own
+class StringTableBuilder {
+public:
+  using size_ty = std::size_t;
+
+private:
+  /// owned copies, in the order of their first add()
+  std::deque<std::string> Strings;
+  /// views into Strings, to the offset once finalized
+  std::unordered_map<std::string_view, size_ty> Offsets;
+  std::vector<uint8_t> Buffer;
+  bool TailMerge;
+  bool Finalized = false;
+
+public:
+  explicit StringTableBuilder(bool _TailMerge = true)
+      : TailMerge(_TailMerge) {}
+
+  StringTableBuilder(const StringTableBuilder&) = delete;
+  StringTableBuilder& operator=(const StringTableBuilder&) = delete;
+
+  void add(StringRef Str);
+
+  /// without TailMerge the strings keep the order they were added in
+  void finalize();
+
+  size_ty getOffset(StringRef Str) const;
+
+  /// the laid out table, a NUL first
+  const uint8_t* data() const { return Buffer.data(); }
+  size_ty size() const { return Buffer.size(); }
+};
+
+} // namespace ADT
+} // namespace utils
+
+#endif
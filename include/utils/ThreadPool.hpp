@@ -0,0 +1,69 @@
+#ifndef UTILS_THREADPOOL
+#define UTILS_THREADPOOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+/// fixed-size work-stealing pool.
+/// every worker owns a deque, it pops its own tasks from the back and steals
+/// from the front of the others once it runs dry, so a few large inputs
+/// queued behind each other still spread over all threads
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct Queue {
+    std::mutex Lock;
+    std::deque<Task> Tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> Queues;
+  std::vector<std::thread> Workers;
+
+  /// guards sleeping, waking, Pending and Error
+  std::mutex Lock;
+  std::condition_variable Wake;
+  std::condition_variable Idle;
+
+  std::atomic<std::size_t> Queued = 0; // sitting in some deque
+  std::size_t Pending = 0;             // submitted and not finished yet
+  std::exception_ptr Error;            // the first a task threw
+  std::atomic<unsigned> NextQueue = 0;
+  bool Stop = false;
+
+  bool pop(unsigned Self, Task& Out);
+  void run(unsigned Self);
+
+public:
+  /// 0 picks std::thread::hardware_concurrency()
+  explicit ThreadPool(unsigned Threads = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// finishes the queued tasks, then joins
+  ~ThreadPool();
+
+  void submit(Task Job);
+
+  /// block until every submitted task has finished, then rethrow the first
+  /// exception one of them threw
+  void wait();
+
+  unsigned size() const { return static_cast<unsigned>(Workers.size()); }
+};
+
+} // namespace utils
+
+#endif
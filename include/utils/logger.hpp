@@ -2,6 +2,7 @@
 #define UTILS_LOGGER_HPP
 
 #include <chrono>
+#include <cstdlib>
 #include <format>
 #include <iostream>
 #include <mutex>
@@ -64,6 +65,26 @@ void info(std::string_view format_str, Args&&... args) {
     std::unreachable();
 }
 
+/// what fatal throws once the error is reported. a pool worker cant exit
+/// under the others, so it reaches main through ThreadPool::wait() instead
+struct FatalError {};
+
+/// a user error: bad arguments or input, a file that cant be used. reported
+/// in every build type, then main exits with 1
+[[noreturn]] inline void
+fatal(std::string_view message,
+      const std::source_location& location = std::source_location::current()) {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cerr << std::format("[{}] [{}] {}\n"
+                                 "  -> at {}:{}\n",
+                                 get_formatted_timestamp(),
+                                 colorize("FATAL", COLOR_RED), message,
+                                 location.file_name(), location.line());
+    }
+    throw FatalError{};
+}
+
 [[noreturn]] inline void
 todo(std::string_view message = "NoImplmented code executed",
      const std::source_location& location = std::source_location::current()) {
@@ -100,6 +121,8 @@ inline void assert_handler(bool condition, std::string_view expression,
 } // namespace logger
 
 using logger::assert_handler;
+using logger::fatal;
+using logger::FatalError;
 using logger::info;
 using logger::todo;
 using logger::unreachable;
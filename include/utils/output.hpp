@@ -0,0 +1,66 @@
+#ifndef UTILS_OUTPUT
+#define UTILS_OUTPUT
+
+#include "utils/ADT/StringRef.hpp"
+#include <cstddef>
+#include <sys/uio.h>
+#include <vector>
+
+namespace utils {
+
+/// write-only handle on an output file.
+/// append() only records where the bytes are, flush() hands everything
+/// recorded so far to writev in as few calls as IOV_MAX allows, so the
+/// appended buffers must stay alive until then. "-" writes to stdout
+class OutputFile {
+  int fd = -1;
+  std::size_t Size = 0; // bytes appended, flushed or not
+  std::vector<iovec> Pending;
+
+  OutputFile() = default;
+
+public:
+  /// source of every padding gap, no gap allocates
+  static constexpr std::size_t ZeroPageSize = 4096;
+  alignas(64) static const char ZeroPage[ZeroPageSize];
+
+  static OutputFile open(ADT::StringRef Path);
+
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+  OutputFile(OutputFile&& Other);
+  OutputFile& operator=(OutputFile&&) = delete;
+
+  ~OutputFile();
+
+  void append(const void* Data, std::size_t N) {
+    if (N) {
+      Pending.push_back({const_cast<void*>(Data), N});
+      Size += N;
+    }
+  }
+
+  void appendZeros(std::size_t N) {
+    for (; N > ZeroPageSize; N -= ZeroPageSize) {
+      append(ZeroPage, ZeroPageSize);
+    }
+    append(ZeroPage, N);
+  }
+
+  /// pad with zeros up to Offset
+  void padTo(std::size_t Offset) { appendZeros(Offset - Size); }
+
+  std::size_t tell() const { return Size; }
+
+  void flush();
+
+  /// whether pwrite() works, false on pipes and terminals
+  bool seekable() const;
+
+  /// overwrite already flushed bytes, the end of the file stays put
+  void pwrite(const void* Data, std::size_t N, std::size_t Offset);
+};
+
+} // namespace utils
+
+#endif
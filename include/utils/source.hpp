@@ -1,15 +1,50 @@
 #ifndef UTILS_SOURCE
 #define UTILS_SOURCE
 
-/// TODO: SourceMgr, Dump
+/// TODO: Dump
 
+#include "utils/ADT/StringRef.hpp"
 #include <cstddef>
+#include <string>
 namespace utils {
 
+/// byte offset into the source buffer, the only position tokens and insts
+/// keep around. Lexer::getLocation turns it into a Location on demand
+using SourceOffset = std::size_t;
+
 struct Location {
   std::size_t line, col;
 };
 
+/// read-only contents of an input file.
+/// regular files are mmap'd and lexed in place, stdin ("-"), pipes and other
+/// unmappable streams are read into an owned buffer
+class SourceBuffer {
+  const char* Data = nullptr;
+  std::size_t Size = 0;
+  bool Mapped = false;
+  std::string Buffered;
+
+  SourceBuffer() = default;
+
+  void readAll(int fd);
+
+public:
+  static SourceBuffer open(ADT::StringRef Path);
+
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  SourceBuffer(SourceBuffer&& Other);
+  SourceBuffer& operator=(SourceBuffer&&) = delete;
+
+  ~SourceBuffer();
+
+  /// tokens borrow from this view, keep the SourceBuffer alive while parsing
+  ADT::StringRef getBuffer() const { return ADT::StringRef(Data, Size); }
+
+  bool isMapped() const { return Mapped; }
+};
+
 } // namespace utils
 
 #endif
@@ -1,44 +1,269 @@
 #include "mc/MCContext.hpp"
+#include "mc/MCOrdering.hpp"
 #include "parser/Lexer.hpp"
 #include "parser/Parser.hpp"
+#include "utils/ADT/StringRef.hpp"
+#include "utils/ThreadPool.hpp"
 #include "utils/logger.hpp"
 #include "utils/macro.hpp"
-#include <cstring>
-#include <fstream>
+#include "utils/output.hpp"
+#include "utils/source.hpp"
+#include <charconv>
+#include <filesystem>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
 
-std::string readFileToString(const std::string& filename) {
-  std::ifstream file(filename, std::ios::binary);
-  if (!file) {
-    utils::unreachable("Failed to open file");
+/// usage:
+///   mc [-j N] [options] -c a.s -o a.o
+///   mc [-j N] [options] a.s b.s ... -o outdir/
+///
+/// batch mode assembles every input on a thread pool, each with its own
+/// MCContext/Parser, and writes outdir/<stem>.o. the opcode and register
+/// tables are constexpr and shared by all of them.
+/// with -c, N > 1 splits the one input into chunks parsed in parallel.
+///
+/// options:
+///   --stream          write .text out while parsing to bound memory on
+///                     huge inputs, every input is parsed serially. branches
+///                     are not relaxed, one out of range is an error
+///   --discard-locals  leave local labels no relocation refers to out of
+///                     .symtab
+///   --rvc             compress every eligible inst, as if the input started
+///                     with .option rvc
+///   --relax           leave calls, %hi/%lo pairs and .align padding in .text
+///                     to the linker, as if the input started with
+///                     .option relax. a jump or branch past the reach of
+///                     jal may then take t1, without relax it is an error
+///   --function-sections
+///                     put every function of .text, from a label declared
+///                     .globl before it on, into a .text.<label> of its own
+///                     for --gc-sections. only .text itself is streamed.
+///                     an error past 65279 sections, there is no SHN_XINDEX
+///   --symbol-ordering-file F
+///                     lay the functions of .text out in the order F lists
+///                     them, one symbol per line, the rest behind them
+///   --profile F       the same from "symbol count" lines, the most samples
+///                     first. a function without samples is cold
+///   --split-cold      put the functions not ordered into .text.unlikely
+///                     instead of behind the others
+///   --icf             fold the global functions of .text that assemble to
+///                     the same bytes and relocations into one, the others
+///                     become aliases of it. cuts .text by function as
+///                     --function-sections does, which keeps the cut. the
+///                     cut is made while parsing, so the same 65279 section
+///                     limit holds even where the folded object is smaller
+///   --align-functions=N
+///                     pad with nops so every function of a text section
+///                     starts at a multiple of N, a power of two
+///   --align-loops=N   the same for the targets of backward branches and
+///                     jumps. both are left out with --stream, under relax
+///                     the linker may shift what they aligned
+
+using StringRef = utils::ADT::StringRef;
+
+namespace {
+
+struct Options {
+  bool Stream = false;
+  bool DiscardLocals = false;
+  bool RVC = false;
+  bool Relax = false;
+  bool FunctionSections = false;
+  const mc::MCOrdering* Ordering = nullptr;
+  bool SplitCold = false;
+  bool FoldFunctions = false;
+  std::size_t AlignFunctions = 0;
+  std::size_t AlignLoops = 0;
+};
+
+void assembleTo(const char* Input, const std::string& Output,
+                const Options& Opts, utils::ThreadPool* Pool) {
+  auto Source = utils::SourceBuffer::open(Input); // "-" reads stdin
+  auto OutputFile = utils::OutputFile::open(Output); // "-" writes stdout
+
+  auto Ctx = mc::MCContext(OutputFile);
+
+  Ctx.setDiscardLocals(Opts.DiscardLocals);
+  Ctx.setRVC(Opts.RVC);
+  Ctx.setRelax(Opts.Relax);
+  Ctx.setFunctionSections(Opts.FunctionSections);
+  Ctx.setOrdering(Opts.Ordering, Opts.SplitCold);
+  Ctx.setFoldFunctions(Opts.FoldFunctions, Pool);
+  Ctx.setAutoAlign(Opts.AlignFunctions, Opts.AlignLoops);
+  if (Opts.Stream) {
+    Ctx.setStreaming();
+  }
+
+  if (Pool) {
+    parser::parseParallel(Ctx, Source.getBuffer(), *Pool);
+  } else {
+    auto Lexer = parser::Lexer(Source.getBuffer()); // source file
+    auto Parser = parser::Parser(Ctx, Lexer);
+
+    Parser.parse();
   }
 
-  file.seekg(0, std::ios::end);
-  std::size_t size = file.tellg();
-  std::string buffer(size, '\0');
+  Ctx.writein();
+}
 
-  file.seekg(0);
-  file.read(buffer.data(), size);
-  return buffer;
+void assemble(const char* Input, const std::string& Output,
+              const Options& Opts, utils::ThreadPool* Pool = nullptr) {
+  try {
+    assembleTo(Input, Output, Opts, Pool);
+  } catch (const utils::FatalError&) {
+    /// a truncated object would still look like one to make
+    if (Output != "-") {
+      std::filesystem::remove(Output);
+    }
+    throw;
+  }
 }
 
-int main(int argc, char* argv[]) {
-  std::ofstream OutputFile;
-  std::string SourceFileStr;
+int run(int argc, char* argv[]) {
+  std::vector<const char*> Inputs;
+  const char* Output = nullptr;
+  bool Single = false;
+  Options Opts;
+  const char* SymbolFile = nullptr;
+  const char* Profile = nullptr;
+  unsigned Jobs = 0; // hardware_concurrency
 
-  utils_assert(argc == 5, "expecting 4 arguments");
+  auto value = [&](int& i) {
+    if (i + 1 >= argc) {
+      utils::fatal("missing argument value");
+    }
+    return argv[++i];
+  };
 
-  utils_assert(!std::memcmp(argv[1], "-c", 2), "expecting '-c' argument");
-  SourceFileStr = readFileToString(argv[2]);
-  utils_assert(!std::memcmp(argv[3], "-o", 2), "expecting '-o' argument");
-  OutputFile = std::ofstream(argv[4], std::ios::binary);
+  /// N of --align-*=N
+  auto alignment = [](StringRef Num) {
+    std::size_t Align = 0;
+    auto [ptr, ec] = std::from_chars(Num.begin(), Num.end(), Align);
+    if (ec != std::errc{} || ptr != Num.end() || Align == 0 ||
+        (Align & (Align - 1)) != 0) {
+      utils::fatal("expecting a power of two after '--align-*='");
+    }
+    return Align;
+  };
 
-  auto Lexer = parser::Lexer(SourceFileStr); // source file
-  auto Ctx = mc::MCContext(OutputFile);
-  auto Parser = parser::Parser(Ctx, Lexer);
+  for (int i = 1; i < argc; ++i) {
+    StringRef Arg(argv[i]);
 
-  Parser.parse();
+    if (Arg == "-c") {
+      Single = true;
+      Inputs.push_back(value(i));
+    } else if (Arg == "--stream") {
+      Opts.Stream = true;
+    } else if (Arg == "--discard-locals") {
+      Opts.DiscardLocals = true;
+    } else if (Arg == "--rvc") {
+      Opts.RVC = true;
+    } else if (Arg == "--relax") {
+      Opts.Relax = true;
+    } else if (Arg == "--function-sections") {
+      Opts.FunctionSections = true;
+    } else if (Arg == "--symbol-ordering-file") {
+      SymbolFile = value(i);
+    } else if (Arg == "--profile") {
+      Profile = value(i);
+    } else if (Arg == "--split-cold") {
+      Opts.SplitCold = true;
+    } else if (Arg == "--icf") {
+      Opts.FoldFunctions = true;
+    } else if (Arg.begin_with("--align-functions=")) {
+      Opts.AlignFunctions = alignment(Arg.slice(sizeof("--align-functions")));
+    } else if (Arg.begin_with("--align-loops=")) {
+      Opts.AlignLoops = alignment(Arg.slice(sizeof("--align-loops")));
+    } else if (Arg == "-o") {
+      Output = value(i);
+    } else if (Arg.begin_with("-j")) {
+      StringRef Num = Arg.size() > 2 ? Arg.slice(2) : StringRef(value(i));
+      auto [ptr, ec] = std::from_chars(Num.begin(), Num.end(), Jobs);
+      if (ec != std::errc{} || ptr != Num.end()) {
+        utils::fatal("expecting a thread count after '-j'");
+      }
+    } else {
+      Inputs.push_back(argv[i]);
+    }
+  }
 
-  Ctx.writein();
+  if (Inputs.empty() || !Output) {
+    utils::fatal("expecting '-c <file> -o <file>' or "
+                       "'[-j N] <files...> -o <dir>'");
+  }
+
+  std::optional<mc::MCOrdering> Ordering;
+  if (SymbolFile && Profile) {
+    utils::fatal("'--symbol-ordering-file' and '--profile' exclude "
+                       "each other");
+  }
+  if (SymbolFile || Profile) {
+    auto File = utils::SourceBuffer::open(SymbolFile ? SymbolFile : Profile);
+    Ordering = SymbolFile ? mc::MCOrdering::fromSymbolFile(File.getBuffer())
+                          : mc::MCOrdering::fromProfile(File.getBuffer());
+    Opts.Ordering = &*Ordering;
+  }
+  if (Opts.Ordering && Opts.Stream) {
+    utils::fatal("'--stream' cant reorder functions");
+  }
+  if (Opts.FoldFunctions && Opts.Stream) {
+    utils::fatal("'--stream' cant fold functions");
+  }
+
+  if (Single) {
+    if (Inputs.size() != 1) {
+      utils::fatal("'-c' takes exactly one input");
+    }
+    if (Jobs > 1 && !Opts.Stream) {
+      utils::ThreadPool Pool(Jobs);
+      assemble(Inputs.front(), Output, Opts, &Pool);
+    } else {
+      assemble(Inputs.front(), Output, Opts);
+    }
+    return 0;
+  }
+
+  namespace fs = std::filesystem;
+
+  fs::path OutDir(Output);
+  fs::create_directories(OutDir);
+
+  std::vector<std::string> Outputs;
+  std::set<std::string> Seen;
+  for (const auto* Input : Inputs) {
+    if (StringRef(Input) == "-") {
+      utils::fatal("stdin can only be assembled with '-c'");
+    }
+
+    auto Object = (OutDir / fs::path(Input).stem()).string() + ".o";
+    if (!Seen.insert(Object).second) {
+      utils::fatal("two inputs map to the same object file");
+    }
+    Outputs.push_back(std::move(Object));
+  }
+
+  utils::ThreadPool Pool(Jobs);
+
+  for (std::size_t i = 0; i < Inputs.size(); ++i) {
+    Pool.submit([Input = Inputs[i], &Object = Outputs[i], &Opts] {
+      assemble(Input, Object, Opts);
+    });
+  }
+
+  Pool.wait();
 
   return 0;
-}
\ No newline at end of file
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  /// fatal has reported the error already, here the workers are done too
+  try {
+    return run(argc, argv);
+  } catch (const utils::FatalError&) {
+    return 1;
+  }
+}
@@ -0,0 +1,208 @@
+#include "mc/MCBatchEncoder.hpp"
+#include "utils/logger.hpp"
+#include "utils/misc.hpp"
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace mc;
+
+namespace {
+
+/// operand columns of one format, Out is the byte offset of the inst in .text.
+/// the reg operands are packed a byte each into Regs. kept small enough that
+/// all formats stay in L1 between gathering and encoding
+struct Columns {
+  static constexpr std::size_t Capacity = 256;
+
+  alignas(32) std::array<uint32_t, Capacity> Base;
+  alignas(32) std::array<uint32_t, Capacity> Regs;
+  alignas(32) std::array<uint32_t, Capacity> Imm;
+  alignas(32) std::array<uint32_t, Capacity> Out;
+  std::size_t Size = 0;
+
+  std::size_t size() const { return Size; }
+  bool full() const { return Size == Capacity; }
+};
+
+template <MCFormat F>
+void gather(Columns& Cols, const MCInstStore& Insts, MCInstStore::Index Idx,
+            uint32_t Base, uint32_t Out) {
+  static constexpr const MCLayout& L = Layouts[std::size_t(F)];
+
+  if (Insts.numRegs()[Idx] < L.NumRegs) {
+    utils::unreachable("cant find the right reg op");
+  }
+
+  uint32_t Imm = 0;
+  if constexpr (L.NumImms != 0) {
+    if (Insts.kinds()[Idx] != MCInstStore::kImm) {
+      utils::unreachable("cant find the imm op");
+    }
+    Imm = static_cast<uint32_t>(
+        utils::signIntCompress(Insts.imms()[Idx], L.ImmBits));
+  }
+
+  /// the layout masks off any reg past the ones it uses
+  auto Regs = Insts.regs()[Idx];
+
+  auto i = Cols.Size++;
+  Cols.Base[i] = Base;
+  Cols.Regs[i] = Regs;
+  Cols.Imm[i] = Imm;
+  Cols.Out[i] = Out;
+}
+
+template <MCFormat F>
+uint32_t scatter(const Columns& Cols, std::size_t i) {
+  static constexpr const MCLayout& L = Layouts[std::size_t(F)];
+
+  uint32_t Bits = Cols.Base[i];
+  auto Regs = Cols.Regs[i];
+  auto Imm = Cols.Imm[i];
+
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((Bits |= ((Regs >> (8 * L.Regs[I].Op)) & L.Regs[I].Mask)
+              << L.Regs[I].Shift),
+     ...);
+  }(std::make_index_sequence<L.NumRegs>{});
+
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((Bits |= ((Imm >> L.Imms[I].Low) & L.Imms[I].Mask) << L.Imms[I].Shift),
+     ...);
+  }(std::make_index_sequence<L.NumImms>{});
+
+  return Bits;
+}
+
+#if defined(__AVX2__)
+template <MCFormat F>
+__m256i scatter8(const Columns& Cols, std::size_t i) {
+  static constexpr const MCLayout& L = Layouts[std::size_t(F)];
+
+  auto load = [&](const std::array<uint32_t, Columns::Capacity>& Col) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&Col[i]));
+  };
+
+  auto Bits = load(Cols.Base);
+  auto Regs = load(Cols.Regs);
+  auto Imm = load(Cols.Imm);
+
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((Bits = _mm256_or_si256(
+          Bits, _mm256_slli_epi32(
+                    _mm256_and_si256(_mm256_srli_epi32(Regs, 8 * L.Regs[I].Op),
+                                     _mm256_set1_epi32(L.Regs[I].Mask)),
+                    L.Regs[I].Shift))),
+     ...);
+  }(std::make_index_sequence<L.NumRegs>{});
+
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((Bits = _mm256_or_si256(
+          Bits, _mm256_slli_epi32(
+                    _mm256_and_si256(_mm256_srli_epi32(Imm, L.Imms[I].Low),
+                                     _mm256_set1_epi32(L.Imms[I].Mask)),
+                    L.Imms[I].Shift))),
+     ...);
+  }(std::make_index_sequence<L.NumImms>{});
+
+  return Bits;
+}
+#endif
+
+template <MCFormat F> void kernel(Columns& Cols, uint8_t* Text) {
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 8 <= Cols.size(); i += 8) {
+    auto Bits = scatter8<F>(Cols, i);
+
+    /// runs of one format are contiguous in .text
+    if (Cols.Out[i + 7] - Cols.Out[i] == 28) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(Text + Cols.Out[i]),
+                          Bits);
+      continue;
+    }
+
+    alignas(32) uint32_t Words[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(Words), Bits);
+    for (std::size_t k = 0; k < 8; ++k) {
+      std::memcpy(Text + Cols.Out[i + k], &Words[k], 4);
+    }
+  }
+#endif
+
+  for (; i < Cols.size(); ++i) {
+    auto Bits = scatter<F>(Cols, i);
+    std::memcpy(Text + Cols.Out[i], &Bits, 4);
+  }
+
+  Cols.Size = 0;
+}
+
+template <MCFormat F>
+void encode(Columns& Cols, const MCInstStore& Insts, MCInstStore::Index Idx,
+            uint32_t Base, uint32_t Out, uint8_t* Text) {
+  gather<F>(Cols, Insts, Idx, Base, Out);
+  if (Cols.full()) {
+    kernel<F>(Cols, Text);
+  }
+}
+
+} // namespace
+
+std::size_t mc::encodeText(const MCInstStore& Insts, uint8_t* Text) {
+  auto Formats = std::make_unique<std::array<Columns, MCFormatCnt>>();
+  auto Cols = [&](MCFormat F) -> Columns& {
+    return (*Formats)[std::size_t(F)];
+  };
+
+  const auto& OpCodes = Insts.opcodes();
+  std::size_t Pos = 0;
+
+  for (MCInstStore::Index i = 0; i < Insts.size(); ++i) {
+    const auto& Info = BatchInfos[OpCodes[i]];
+    auto Out = static_cast<uint32_t>(Pos);
+
+    switch (Info.Format) {
+    case MCFormat::R:
+      encode<MCFormat::R>(Cols(MCFormat::R), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::I:
+      encode<MCFormat::I>(Cols(MCFormat::I), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::S:
+      encode<MCFormat::S>(Cols(MCFormat::S), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::B:
+      encode<MCFormat::B>(Cols(MCFormat::B), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::U:
+      encode<MCFormat::U>(Cols(MCFormat::U), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::J:
+      encode<MCFormat::J>(Cols(MCFormat::J), Insts, i, Info.Base, Out, Text);
+      break;
+    case MCFormat::Other: {
+      auto Bits = Encoders[OpCodes[i]](Insts.getOps(i));
+      std::memcpy(Text + Pos, &Bits, Info.Size);
+      break;
+    }
+    }
+
+    Pos += Info.Size;
+  }
+
+  kernel<MCFormat::R>(Cols(MCFormat::R), Text);
+  kernel<MCFormat::I>(Cols(MCFormat::I), Text);
+  kernel<MCFormat::S>(Cols(MCFormat::S), Text);
+  kernel<MCFormat::B>(Cols(MCFormat::B), Text);
+  kernel<MCFormat::U>(Cols(MCFormat::U), Text);
+  kernel<MCFormat::J>(Cols(MCFormat::J), Text);
+
+  return Pos;
+}
@@ -0,0 +1,195 @@
+#include "mc/MCCompress.hpp"
+#include "mc/MCEncoder.hpp"
+#include "mc/MCOpCode.hpp"
+#include "mc/MCOperand.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using namespace mc;
+
+namespace {
+
+constexpr MCReg X0 = 0;
+constexpr MCReg RA = 1;
+constexpr MCReg SP = 2;
+
+/// the reg operands of an inst by field. the encoders number them rd, rs1,
+/// rs2 in that order, without rd when the inst has none
+struct RegFields {
+  MCReg Rd = X0;
+  MCReg Rs1 = X0;
+  MCReg Rs2 = X0;
+};
+
+RegFields unpack(const MCOpCode& Op, uint32_t Regs) {
+  auto reg = [&](unsigned Slot) {
+    return static_cast<MCReg>(Regs >> (8 * Slot));
+  };
+
+  if (Op.hasRd) {
+    return {reg(0), reg(1), reg(2)};
+  }
+  return {X0, reg(0), reg(1)};
+}
+
+MCPackedOps pack(const MCOpCode& Op, RegFields F, const MCPackedOps& From) {
+  MCPackedOps Ops = From;
+
+  if (Op.hasRd) {
+    Ops.Regs = F.Rd | uint32_t(F.Rs1) << 8 | uint32_t(F.Rs2) << 16;
+    Ops.NumRegs = 3;
+  } else {
+    Ops.Regs = F.Rs1 | uint32_t(F.Rs2) << 8;
+    Ops.NumRegs = 2;
+  }
+  return Ops;
+}
+
+/// whether the encoder of Op takes Imm as it is: within its width, signed
+/// or not as the encoder reads it, and a multiple of its lowest encoded bit
+template <const MCOpCode& Op> bool fits(int64_t Imm) {
+  static constexpr const MCEncoder& E = EncoderOf<Op>;
+  static constexpr unsigned Low = [] {
+    unsigned Low = 31;
+    for (unsigned i = 0; i < E.NumImms; ++i) {
+      Low = std::min<unsigned>(Low, E.Imms[i].Low);
+    }
+    return Low;
+  }();
+
+  auto Min = E.ImmUnsigned ? 0 : -(int64_t(1) << (E.ImmBits - 1));
+  auto Max = int64_t(1) << (E.ImmBits - (E.ImmUnsigned ? 0 : 1));
+  return Imm >= Min && Imm < Max && (Imm & ((int64_t(1) << Low) - 1)) == 0;
+}
+
+} // namespace
+
+bool mc::compressInst(MCInstStore& Insts, MCInstStore::Index i) {
+  const auto& Op = Insts.getOpCode(i);
+  auto Ops = Insts.getOps(i);
+  auto [Rd, Rs1, Rs2] = unpack(Op, Ops.Regs);
+  auto Imm = static_cast<int64_t>(Ops.Imm);
+
+  auto to = [&](const MCOpCode& C, RegFields F) {
+    Insts.rewrite(i, C, pack(C, F, Ops));
+    return true;
+  };
+
+  /// rd = rd op rs2 of the CA format, either order for a commutative op
+  auto arith = [&](const MCOpCode& C, bool Commutative) {
+    if (!isCRegister(Rd) || !isCRegister(Rs1) || !isCRegister(Rs2)) {
+      return false;
+    }
+    if (Rd == Rs1) {
+      return to(C, {Rd, X0, Rs2});
+    }
+    if (Commutative && Rd == Rs2) {
+      return to(C, {Rd, X0, Rs1});
+    }
+    return false;
+  };
+
+  switch (static_cast<OpIndex>(Op.index)) {
+  case OpIndex::ADDI:
+    if (Rd == X0) {
+      return Rs1 == X0 && Imm == 0 && to(C_NOP, {});
+    }
+    if (Rs1 == X0 && fits<C_LI_D>(Imm)) {
+      return to(C_LI_D, {Rd});
+    }
+    if (Imm == 0) {
+      return to(C_MV, {Rd, X0, Rs1});
+    }
+    if (Rd == Rs1 && fits<C_ADDI>(Imm)) {
+      return to(C_ADDI, {Rd});
+    }
+    if (Rd == SP && Rs1 == SP && fits<C_ADDI16SP>(Imm)) {
+      return to(C_ADDI16SP, {});
+    }
+    if (isCRegister(Rd) && Rs1 == SP && Imm > 0 && fits<C_ADDI4SPN>(Imm)) {
+      return to(C_ADDI4SPN, {Rd});
+    }
+    return false;
+  case OpIndex::ADDIW:
+    return Rd != X0 && Rd == Rs1 && fits<C_ADDIW>(Imm) && to(C_ADDIW, {Rd});
+  case OpIndex::ADD:
+    if (Rd == X0) {
+      return false;
+    }
+    if (Rs1 == X0 && Rs2 != X0) {
+      return to(C_MV, {Rd, X0, Rs2});
+    }
+    if (Rd == Rs1 && Rs2 != X0) {
+      return to(C_ADD, {Rd, X0, Rs2});
+    }
+    if (Rd == Rs2 && Rs1 != X0) {
+      return to(C_ADD, {Rd, X0, Rs1});
+    }
+    return false;
+  case OpIndex::SUB:
+    return arith(C_SUB, false);
+  case OpIndex::SUBW:
+    return arith(C_SUBW, false);
+  case OpIndex::ADDW:
+    return arith(C_ADDW, true);
+  case OpIndex::XOR:
+    return arith(C_XOR, true);
+  case OpIndex::OR:
+    return arith(C_OR, true);
+  case OpIndex::AND:
+    return arith(C_AND, true);
+  case OpIndex::ANDI:
+    return isCRegister(Rd) && Rd == Rs1 && fits<C_ANDI>(Imm) &&
+           to(C_ANDI, {Rd});
+  case OpIndex::SLLI:
+    return Rd != X0 && Rd == Rs1 && Imm > 0 && fits<C_SLLI_D>(Imm) &&
+           to(C_SLLI_D, {Rd});
+  case OpIndex::SRLI:
+    return isCRegister(Rd) && Rd == Rs1 && Imm > 0 && fits<C_SRLI_D>(Imm) &&
+           to(C_SRLI_D, {Rd});
+  case OpIndex::SRAI:
+    return isCRegister(Rd) && Rd == Rs1 && Imm > 0 && fits<C_SRAI>(Imm) &&
+           to(C_SRAI, {Rd});
+  case OpIndex::LW:
+    if (Rd != X0 && Rs1 == SP && Imm >= 0 && fits<C_LWSP>(Imm)) {
+      return to(C_LWSP, {Rd});
+    }
+    return isCRegister(Rd) && isCRegister(Rs1) && Imm >= 0 &&
+           fits<C_LW>(Imm) && to(C_LW, {Rd, Rs1});
+  case OpIndex::LD:
+    if (Rd != X0 && Rs1 == SP && Imm >= 0 && fits<C_LDSP>(Imm)) {
+      return to(C_LDSP, {Rd});
+    }
+    return isCRegister(Rd) && isCRegister(Rs1) && Imm >= 0 &&
+           fits<C_LD>(Imm) && to(C_LD, {Rd, Rs1});
+  case OpIndex::SW:
+    if (Rs1 == SP && Imm >= 0 && fits<C_SWSP>(Imm)) {
+      return to(C_SWSP, {X0, X0, Rs2});
+    }
+    return isCRegister(Rs1) && isCRegister(Rs2) && Imm >= 0 &&
+           fits<C_SW>(Imm) && to(C_SW, {X0, Rs1, Rs2});
+  case OpIndex::SD:
+    if (Rs1 == SP && Imm >= 0 && fits<C_SDSP>(Imm)) {
+      return to(C_SDSP, {X0, X0, Rs2});
+    }
+    return isCRegister(Rs1) && isCRegister(Rs2) && Imm >= 0 &&
+           fits<C_SD>(Imm) && to(C_SD, {X0, Rs1, Rs2});
+  case OpIndex::JALR:
+    if (Imm != 0 || Rs1 == X0) {
+      return false;
+    }
+    if (Rd == X0) {
+      return to(C_JR, {X0, Rs1});
+    }
+    return Rd == RA && to(C_JALR, {X0, Rs1});
+  case OpIndex::EBREAK:
+    return to(C_EBREAK, {});
+  case OpIndex::LUI:
+    /// the imm is the sign extended value, c.lui takes bits 17:12 of it
+    return Rd != X0 && Rd != SP && Imm != 0 && fits<C_LUI_D>(Imm) &&
+           to(C_LUI_D, {Rd});
+  default:
+    /// branches and jumps wait for their label, layoutText() narrows them
+    return false;
+  }
+}
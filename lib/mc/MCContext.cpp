@@ -1,402 +1,1844 @@
 #include "mc/MCContext.hpp"
+#include "mc/MCBatchEncoder.hpp"
+#include "utils/ADT/StringSwitch.hpp"
+#include "utils/ThreadPool.hpp"
+#include "utils/logger.hpp"
 #include "utils/macro.hpp"
+#include "utils/misc.hpp"
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <elf.h>
+#include <format>
 #include <iterator>
+#include <memory>
+#include <numeric>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 using namespace mc;
+template <typename T> using StringSwitch = utils::ADT::StringSwitch<T>;
+
+namespace {
+
+constexpr MCReg X0 = 0;
+constexpr MCReg RA = 1;
+constexpr MCReg T1 = 6;
+
+/// bits of the offset a branch or jal reaches in its short form, 0 for an
+/// inst relaxation leaves alone
+unsigned shortReach(const MCOpCode& OpCode) {
+  switch (static_cast<OpIndex>(OpCode.index)) {
+  case OpIndex::BEQ:
+  case OpIndex::BNE:
+  case OpIndex::BLT:
+  case OpIndex::BGE:
+  case OpIndex::BLTU:
+  case OpIndex::BGEU:
+    return 13;
+  case OpIndex::JAL:
+    return 21;
+  case OpIndex::C_BEQZ:
+  case OpIndex::C_BNEZ:
+    return 9;
+  case OpIndex::C_J:
+  case OpIndex::C_JAL:
+    return 12;
+  default:
+    return 0;
+  }
+}
+
+/// the 32-bit form of a compressed branch or jump, with the operands it
+/// takes. any other inst is left as it is
+std::pair<const MCOpCode*, MCPackedOps> widen(const MCOpCode& OpCode,
+                                              MCPackedOps Ops) {
+  switch (static_cast<OpIndex>(OpCode.index)) {
+  case OpIndex::C_BEQZ:
+    return {&BEQ, {Ops.Regs & 0xff, 2, Ops.HasImm, Ops.Imm}};
+  case OpIndex::C_BNEZ:
+    return {&BNE, {Ops.Regs & 0xff, 2, Ops.HasImm, Ops.Imm}};
+  case OpIndex::C_J:
+    return {&JAL, {X0, 1, Ops.HasImm, Ops.Imm}};
+  case OpIndex::C_JAL:
+    return {&JAL, {RA, 1, Ops.HasImm, Ops.Imm}};
+  default:
+    return {&OpCode, Ops};
+  }
+}
+
+/// the C form of a 32-bit branch or jump, with the operands it takes, null
+/// if it has none: a beq/bne against x0 on one of x8-x15, or a jal x0.
+/// rv64 has no c.jal
+std::pair<const MCOpCode*, MCPackedOps> narrow(const MCOpCode& OpCode,
+                                               MCPackedOps Ops) {
+  auto Rs1 = static_cast<MCReg>(Ops.Regs & 0xff);
+  auto Rs2 = static_cast<MCReg>(Ops.Regs >> 8 & 0xff);
+  auto Reg = Rs2 == X0 ? Rs1 : Rs1 == X0 ? Rs2 : X0;
+
+  switch (static_cast<OpIndex>(OpCode.index)) {
+  case OpIndex::BEQ:
+    return {isCRegister(Reg) ? &C_BEQZ : nullptr,
+            {Reg, 1, Ops.HasImm, Ops.Imm}};
+  case OpIndex::BNE:
+    return {isCRegister(Reg) ? &C_BNEZ : nullptr,
+            {Reg, 1, Ops.HasImm, Ops.Imm}};
+  case OpIndex::JAL:
+    return {Rs1 == X0 ? &C_J : nullptr, {0, 0, Ops.HasImm, Ops.Imm}};
+  default:
+    return {nullptr, Ops};
+  }
+}
+
+const MCOpCode& invertBranch(const MCOpCode& OpCode) {
+  switch (static_cast<OpIndex>(OpCode.index)) {
+  case OpIndex::BEQ:
+    return BNE;
+  case OpIndex::BNE:
+    return BEQ;
+  case OpIndex::BLT:
+    return BGE;
+  case OpIndex::BGE:
+    return BLT;
+  case OpIndex::BLTU:
+    return BGEU;
+  case OpIndex::BGEU:
+    return BLTU;
+  default:
+    utils::unreachable("not a branch");
+  }
+}
+
+/// h with v folded in, the steps of splitmix64
+uint64_t mix(uint64_t h, uint64_t v) {
+  h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+
+bool fitsSigned(int64_t Value, unsigned Bits) {
+  return Value >= -(int64_t(1) << (Bits - 1)) &&
+         Value < (int64_t(1) << (Bits - 1));
+}
+
+/// Size bytes of padding at Offset: a c.nop if it is not a multiple of 4,
+/// then nops. never compressed, the linker counts them for R_RISCV_ALIGN
+void fillNops(MCInstStore& Insts, std::size_t Offset, std::size_t Size,
+              SourceOffset Loc) {
+  if (Size % 4) {
+    Insts.push(C_NOP, Offset, Loc);
+    Offset += 2;
+    Size -= 2;
+  }
+  for (; Size; Offset += 4, Size -= 4) {
+    Insts.push(ADDI, {0, 2, true, 0}, Offset, Loc);
+  }
+}
+
+/// whether running off the end of Section runs into what follows it: the
+/// last inst in front of the pads at its end is no jal x0, jalr x0 or C form
+/// of them. a tail ends in its jalr x0, a section without insts runs on
+bool fallsThrough(const MCSection& Section) {
+  auto End = Section.Size;
+  for (auto Pad = Section.Aligns.rbegin();
+       Pad != Section.Aligns.rend() && Pad->Offset + Pad->Size == End; ++Pad) {
+    End = Pad->Offset;
+  }
+
+  const auto& Insts = Section.Insts;
+  auto i = Insts.size();
+  while (i && Insts.getOffset(i - 1) >= End) {
+    --i;
+  }
+  if (!i) {
+    return true;
+  }
+
+  switch (static_cast<OpIndex>(Insts.getOpCode(i - 1).index)) {
+  case OpIndex::JAL:
+  case OpIndex::JALR:
+    return static_cast<MCReg>(Insts.getOps(i - 1).Regs) != X0;
+  case OpIndex::C_J:
+  case OpIndex::C_JR:
+    return false;
+  default:
+    return true;
+  }
+}
+
+} // namespace
+
+uint32_t MCContext::addSection(StringRef Name, uint32_t Type, uint64_t Flags) {
+  auto It = SectionIds.find(std::string_view(Name.data(), Name.size()));
+  if (It != SectionIds.end()) {
+    return It->second;
+  }
 
-void MCContext::mkStrTab() {
-  /// gather .strtab context
-  /// include label, symbol(relos, variables)
-  StrTabBuffer << '\x00';
+  /// a fixup holds the id in 16 bits, past SHN_LORESERVE elf needs another
+  /// table anyway. checked in every build, a wrapped id corrupts the object
+  if (Sections.size() >= SHN_LORESERVE) {
+    utils::fatal("too many sections, ELF indexes at most 65279 without "
+                 "SHN_XINDEX");
+  }
+
+  auto Id = static_cast<uint32_t>(Sections.size());
+  const auto& Section = Sections.emplace_back(Name, Type, Flags);
+  SectionIds.emplace(Section.Name, Id);
+  return Id;
+}
+
+bool MCContext::canAppend(const MCContext& Chunk) const {
+  for (uint32_t Id = 1; Id < Chunk.Sections.size(); ++Id) {
+    const auto& From = Chunk.Sections[Id];
+
+    auto ToId = TextTail;
+    if (Id != MCSymbol::text) {
+      /// one the chunk made first starts at 0 here as well
+      auto It = SectionIds.find(From.Name);
+      if (It == SectionIds.end()) {
+        continue;
+      }
+      ToId = It->second;
+    }
+
+    const auto& To = Sections[ToId];
+    if (To.Type != From.Type || To.Flags != From.Flags ||
+        To.Size % From.AssumedAlign) {
+      return false;
+    }
+  }
+
+  if (cutsText()) {
+    /// the .text of the chunk, cut by the functions it saw
+    std::vector<bool> InText(Chunk.Sections.size());
+    InText[MCSymbol::text] = true;
+    for (const auto& Sym : Chunk.Syms) {
+      if (Sym.Function) {
+        InText[Sym.Section] = true;
+      }
+    }
+
+    /// a label the .globl of an earlier chunk made a function
+    for (const auto& Sym : Chunk.Syms) {
+      if (Sym.Defined && !Sym.Function && InText[Sym.Section]) {
+        const auto* Here = Syms.find(Sym.Name);
+        if (Here && Here->Global) {
+          return false;
+        }
+      }
+    }
+  }
+
+  return Options == Chunk.EntryOptions;
+}
+
+void MCContext::append(MCContext& Chunk) {
+  utils_assert(!Streaming && !Chunk.Streaming, "cant append a streamed chunk");
+
+  auto FixupBase = static_cast<uint32_t>(Fixups.size());
+
+  /// ids of the chunk sections here, and where each of them starts
+  std::vector<uint32_t> SectionMap(Chunk.Sections.size());
+  std::vector<size_ty> Bases(Chunk.Sections.size());
+  std::vector<Index> InstBases(Chunk.Sections.size());
 
-  /// find extern symbol in relo insts
-  for (auto& [_, sym] : ReloInst) {
-    if (!StrTabBuffer.hasSym(sym)) {
-      StrTabBuffer << sym << '\x00';
+  for (uint32_t Id = 1; Id < Chunk.Sections.size(); ++Id) {
+    auto& From = Chunk.Sections[Id];
+
+    SectionMap[Id] = Id == MCSymbol::text
+                         ? TextTail
+                         : addSection(From.Name, From.Type, From.Flags);
+    auto& To = Sections[SectionMap[Id]];
+
+    auto Base = Bases[Id] = To.Size;
+    InstBases[Id] = static_cast<Index>(To.Insts.size());
+    auto AlignBase = static_cast<uint32_t>(To.Aligns.size());
+
+    To.Insts.append(From.Insts, Base);
+    To.Data.append(From.Data);
+    To.Size += From.Size;
+
+    for (auto Align : From.Aligns) {
+      Align.Offset += static_cast<uint32_t>(Base);
+      To.Aligns.push_back(Align);
+    }
+
+    /// the kData between them are made anew
+    for (auto Frag : From.Frags) {
+      if (Frag.Kind == MCFragment::kData) {
+        continue;
+      }
+      Frag.Start = Frag.Offset = Frag.Start + static_cast<uint32_t>(Base);
+      Frag.Ref += Frag.Kind == MCFragment::kAlign ? AlignBase : FixupBase;
+      To.Frags.add(Frag);
     }
+
+    To.AssumedAlign = std::lcm(To.AssumedAlign, From.AssumedAlign);
+    To.MaxAlign = std::max(To.MaxAlign, From.MaxAlign);
   }
 
-  for (const auto& [relo_sym, ndx] : Symbols) {
-    StrTabBuffer << relo_sym << '\x00';
+  /// ids of the chunk symbols here
+  std::vector<uint32_t> SymIds;
+  SymIds.reserve(Chunk.Syms.size());
+
+  for (const auto& Sym : Chunk.Syms) {
+    SymIds.push_back(Syms.intern(Sym.Name));
+    auto& To = Syms[SymIds.back()];
+
+    if (Sym.Defined) {
+      if (To.Defined) {
+        utils::fatal("symbol redefinition");
+      }
+
+      To.Defined = true;
+      To.Section = SectionMap[Sym.Section];
+      To.Value = Sym.Value + Bases[Sym.Section];
+      To.Function = Sym.Function;
+
+      /// an earlier chunk jumps forward into this one
+      if (Sections[To.Section].Kind == MCSection::kText) {
+        resolveChain(To);
+      }
+    }
+
+    if (Sym.Global) {
+      if (To.Global) {
+        utils::fatal("global symbol redefinition");
+      }
+      To.Global = true;
+    }
   }
 
-  for (const auto& label : TextLabels.keys()) {
-    if (!StrTabBuffer.hasSym(label)) {
-      StrTabBuffer << label << '\x00';
+  /// the chunk resolved its own labels, what is left is defined in another
+  /// chunk or nowhere. chains are rebuilt in this context
+  for (auto Fixup : Chunk.Fixups) {
+    Fixup.Inst += InstBases[Fixup.Section];
+    Fixup.Section = static_cast<uint16_t>(SectionMap[Fixup.Section]);
+    Fixup.Sym = SymIds[Fixup.Sym];
+
+    auto& Sym = Syms[Fixup.Sym];
+    if (!Fixup.Resolved && Sym.Defined && Sym.Section == Fixup.Section) {
+      reloTextSym(Fixup, Sym.Value);
+      Fixup.Resolved = true;
     }
+
+    if (Fixup.Resolved || Sym.Defined) {
+      Fixups.push_back(Fixup);
+      continue;
+    }
+
+    Fixup.Next = Sym.FixupChain;
+    Sym.FixupChain = static_cast<uint32_t>(Fixups.size());
+    Fixups.push_back(Fixup);
   }
+
+  /// the chunk never popped past its own pushes, see popOptions()
+  Options = Chunk.Options;
+  for (auto Saved : Chunk.OptionStack) {
+    OptionStack.push_back(Saved);
+  }
+
+  Cur = SectionMap[Chunk.Cur];
+  TextTail = SectionMap[Chunk.TextTail];
 }
 
-void MCContext::Relo() {
+void MCContext::setStreaming() {
+  utils_assert(Sections[MCSymbol::text].Insts.empty() && file.tell() == 0,
+               "streaming has to start before parsing");
+
+  if (!file.seekable()) {
+    utils::fatal("streaming needs a seekable output file");
+  }
+
+  /// .text follows right behind, the header is patched in by writein()
+  file.appendZeros(sizeof(Elf64_Ehdr));
+  Streaming = true;
+}
+
+bool MCContext::defineSym(StringRef Str, uint32_t ndx, size_ty Value) {
+  auto& Sym = Syms.getOrInsert(Str);
+  if (Sym.Defined) {
+    /// the .globl of a variable defined it here already, the label names it
+    return Sym.Global && Sym.Section == ndx && Sym.Value == Value &&
+           Sections[ndx].Kind != MCSection::kText;
+  }
+
+  Sym.Defined = true;
+  Sym.Section = ndx;
+  Sym.Value = Value;
+
+  if (Sections[ndx].Kind == MCSection::kText) {
+    resolveChain(Sym);
+  }
+  return true;
+}
+
+void MCContext::splitText(StringRef Str) {
+  const auto* Sym = Syms.find(Str);
+  if (Sym && Sym->Defined) {
+    return;
+  }
+  if (!(Sym && Sym->Global) && !(Ordering && Ordering->lists(Str))) {
+    return;
+  }
 
-  for (auto [inst, sym] : ReloInst) {
-    /// if sym def in .text: const Expr* -> imme
-    if (auto where = TextLabels.find(sym)) {
-      int64_t offset = static_cast<int64_t>(*where - inst->getOffset());
-      utils_assert(offset % 2 == 0,
-                   "offset in .text should be align to as least 2");
+  /// addSection would refuse as well, this names the cause
+  if (Sections.size() >= SHN_LORESERVE) {
+    utils::fatal("too many functions for a section each, as --icf, an "
+                 "ordering or --function-sections cut them. ELF indexes at "
+                 "most 65279 sections without SHN_XINDEX");
+  }
 
-      inst->reloSym(offset);
+  auto Id = addSection(".text." + Str.str(), cur().Type, cur().Flags);
 
+  /// an .align right in front of the label was meant for the function
+  const auto& Tail = cur();
+  if (!Tail.Aligns.empty() &&
+      Tail.Aligns.back().Offset + Tail.Aligns.back().Size == Tail.Size) {
+    const auto& Pad = Tail.Aligns.back();
+    auto& Section = Sections[Id];
+    if (!Pad.Relax) {
+      Section.noteAlign(Pad.Align);
     }
-    /// else if: symbols from .data or .bss configure Elf_Rela
-    else if (auto iter =
-                 std::find_if(Symbols.begin(), Symbols.end(),
-                              [&](auto&& elem) { return elem.first == sym; });
-             iter != Symbols.end()) {
+    Section.MaxAlign = std::max<size_ty>(Section.MaxAlign, Pad.Align);
+  }
 
-      auto [sym, _] = *iter;
+  Cur = TextTail = Id;
+  Syms.getOrInsert(Str).Function = true;
+}
 
-      Elf64_Rela Rela = {};
-      Rela.r_offset = inst->getOffset();
-      Rela.r_info =
-          ELF64_R_INFO(5 + std::distance(Symbols.begin(), iter),
-                       inst->getReloType()); // idx pointer to idx in .symtab
+void MCContext::resolveChain(MCSymbol& Sym) {
+  for (auto i = Sym.FixupChain; i != MCFixup::None; i = Fixups[i].Next) {
+    if (Fixups[i].Section == Sym.Section) {
+      reloTextSym(Fixups[i], Sym.Value);
+      Fixups[i].Resolved = true;
+    }
+  }
 
-      auto expr = inst->getExprOp();
+  Sym.FixupChain = MCFixup::None;
+}
 
-      utils_assert(expr, "failed to find an expr in current instruction");
+void MCContext::checkOperands(const MCInstStore& Insts, Index i) {
+  auto& Op = Insts.getOpCode(i);
+  auto Needed = OperandsNeeded[Op.index];
 
-      Rela.r_addend = expr->getExpr()->getAppend();
+  if (Insts.numRegs()[i] < Needed.Regs) {
+    utils::fatal(std::format("{} expects {} register operands",
+                             Op.name.str_view(), unsigned(Needed.Regs)));
+  }
+  if (Needed.Imm && Insts.kinds()[i] != MCInstStore::kImm) {
+    utils::fatal(std::format("{} expects an imm or a symbol operand",
+                             Op.name.str_view()));
+  }
+}
 
-      Elf_Relas.emplace_back(std::move(Rela));
+void MCContext::addTextImm(int64_t Imm) {
+  auto& Insts = cur().Insts;
 
-      inst->reloSym(0ll);
+  auto Op = static_cast<OpIndex>(Insts.getOpCode(Insts.back()).index);
+  if (Op == OpIndex::LUI || Op == OpIndex::AUIPC) {
+    if (Imm < 0 || Imm > 0xfffff) {
+      utils::fatal("expecting an upper imm within 0..0xfffff");
     }
-    /// extern symbols
-    else {
-      this->ExternSymbols.insert(sym);
+    /// the sign extended 32-bit value, as %hi leaves it
+    Imm = static_cast<int32_t>(static_cast<uint32_t>(Imm) << 12);
+  }
 
-      Elf64_Rela Rela = {};
-      Rela.r_offset = inst->getOffset();
-      Rela.r_info = ELF64_R_INFO(
-          5 + Symbols.size() +
-              std::distance(ExternSymbols.begin(), ExternSymbols.find(sym)),
-          inst->getReloType());
+  Insts.addImm(static_cast<uint64_t>(Imm));
+}
 
-      Elf_Relas.emplace_back(std::move(Rela));
+void MCContext::addTextFixup(StringRef Symbol, MCExpr::ExprTy ty,
+                             uint64_t Append) {
+  auto& Insts = cur().Insts;
+  Insts.addImm(0);
 
-      inst->reloSym(0ll);
+  MCFixup Fixup = {Insts.back(), Syms.intern(Symbol), ty};
+  Fixup.Addend = static_cast<int64_t>(Append);
+  addFixup(Fixup);
+}
+
+void MCContext::addCall(StringRef Symbol, bool Tail, SourceOffset Loc) {
+  /// a tail call must not clobber ra, t1 carries the upper bits instead
+  auto Scratch = Tail ? T1 : RA;
+
+  newTextInst(&AUIPC, Loc);
+  addTextReg(Scratch);
+
+  auto& Section = cur();
+  Section.Insts.addImm(0);
+
+  MCFixup Fixup = {Section.Insts.back(), Syms.intern(Symbol), MCExpr::kCALL};
+  incTextOffset();
+
+  /// the jalr is part of the pair, never compressed on its own
+  Section.Insts.push(JALR,
+                     {(Tail ? X0 : RA) | uint32_t(Scratch) << 8, 2, true, 0},
+                     Section.Size, Loc);
+  incTextOffset();
+
+  addFixup(Fixup);
+}
+
+void MCContext::alignSection(MCSection& Section, size_ty Align, bool Relax,
+                             SourceOffset Loc, size_ty MaxSkip) {
+  MCTextAlign Pad = {static_cast<uint32_t>(Section.Size), 0,
+                     static_cast<uint32_t>(Align), Relax, Loc,
+                     static_cast<uint32_t>(std::min<size_ty>(MaxSkip,
+                                                             UINT32_MAX))};
+
+  if (Relax) {
+    /// the linker takes Align as the power of two above Size + 2: the object
+    /// is EF_RISCV_RVC, so any call it shrinks to c.j may leave the padding
+    /// 2-byte aligned. it has no max-skip, a bounded one is left out
+    Pad.Size = Align > 2 ? static_cast<uint32_t>(Align - 2) : 0;
+    if (Pad.Size > Pad.MaxSkip) {
+      return;
+    }
+  } else {
+    Pad.Size = static_cast<uint32_t>((Align - Section.Size % Align) % Align);
+    if (Pad.Size > Pad.MaxSkip) {
+      Pad.Size = 0;
     }
+    Section.noteAlign(Align);
+  }
+
+  if (Pad.Size % 4) {
+    Section.AssumedAlign = std::lcm(Section.AssumedAlign, instAlign(C_NOP));
   }
+
+  /// a relax one is the same size wherever it lands
+  if (!Streaming && !Pad.Relax) {
+    Section.Frags.add({MCFragment::kAlign, Pad.Offset, Pad.Size,
+                       static_cast<uint32_t>(Section.Aligns.size()),
+                       Pad.Align, Pad.MaxSkip});
+  }
+
+  fillNops(Section.Insts, Section.Size, Pad.Size, Loc);
+  Section.Size += Pad.Size;
+
+  Section.MaxAlign = std::max(Section.MaxAlign, Align);
+  Section.Aligns.push_back(Pad);
 }
 
-void MCContext::Ehdr_Shdr() {
-  auto& hdr = this->Elf_Ehdr;
+void MCContext::addFixup(MCFixup Fixup) {
+  auto& Section = cur();
+  Fixup.Relax = Options.Relax;
+  Fixup.RVC = Options.RVC;
+  Fixup.Section = static_cast<uint16_t>(Cur);
+
+  /// a branch or jal on a label may have to grow. only the first imm of an
+  /// inst is encoded, so is its first fixup
+  if (!Streaming && !Fixup.hasModifier() &&
+      shortReach(Section.Insts.getOpCode(Fixup.Inst))) {
+    auto Start = static_cast<uint32_t>(Section.Insts.getOffset(Fixup.Inst));
+    bool Seen = !Section.Frags.empty() &&
+                (Section.Frags.end() - 1)->Kind == MCFragment::kRelaxable &&
+                (Section.Frags.end() - 1)->Start == Start;
+
+    if (!Seen) {
+      Section.Frags.add({MCFragment::kRelaxable, Start,
+                         Section.Insts.isCompressed(Fixup.Inst) ? 2u : 4u,
+                         static_cast<uint32_t>(Fixups.size())});
+    }
+  }
 
-  /// magic number
-  std::memcpy(hdr.e_ident,
-              "\x7f"
-              "ELF",
-              4);
-  hdr.e_ident[EI_CLASS] = ELFCLASS64;
-  hdr.e_ident[EI_DATA] = ELFDATA2LSB;
-  hdr.e_ident[EI_VERSION] = EV_CURRENT;
-  hdr.e_ident[EI_OSABI] = ELFOSABI_NONE; // none
+  /// a backward reference, no chain to wait in. a symbol of another
+  /// section is left to the linker
+  auto& Sym = Syms[Fixup.Sym];
+  if (Sym.Defined) {
+    if (Sym.Section == Fixup.Section) {
+      reloTextSym(Fixup, Sym.Value);
+      Fixup.Resolved = true;
+    }
+    Fixups.push_back(Fixup);
+    return;
+  }
 
-  hdr.e_type = ET_REL;
-  hdr.e_machine = EM_RISCV;
-  hdr.e_version = EV_CURRENT;
-  hdr.e_flags = EF_RISCV_RVC | EF_RISCV_FLOAT_ABI_DOUBLE;
-  hdr.e_ehsize = sizeof(std::decay_t<decltype(hdr)>);
-  hdr.e_shentsize = sizeof(Elf64_Shdr);
+  Fixup.Next = Sym.FixupChain;
+  Sym.FixupChain = static_cast<uint32_t>(Fixups.size());
+  Fixups.push_back(Fixup);
+}
 
-  /// TODO: .section and more sections
-  /// <void> .text .data .bss .strtab .symtab .rela_text .shstrtab
-  hdr.e_shnum = 8;
-  hdr.e_shstrndx = 7;
+void MCContext::streamText() {
+  auto& Text = Sections[MCSymbol::text];
 
-  /// estimate the offset to the section header table
-  size_ty offset = 0;
-  auto mkAlign = [&](size_ty alignment) {
-    offset += (alignment - (offset % alignment)) % alignment;
-  };
+  for (auto Fixup : Fixups) {
+    if (Fixup.Resolved) {
+      checkReach(Fixup);
+    }
+    /// a relax one is resolved but still needs its Elf64_Rela
+    if (Fixup.Resolved && !Fixup.Relax) {
+      continue;
+    }
 
-  {
-    Offsets.insert("elf header", 0);
-    offset += sizeof(std::decay_t<decltype(hdr)>);
+    /// a label of a later window or a symbol from elsewhere, decided in
+    /// writein(). the inst goes out with its zero imm meanwhile, and the
+    /// chain would point into the window, so it is dropped. the insts of
+    /// the other sections stay where they are
+    auto i = Fixup.Inst;
+    Syms[Fixup.Sym].FixupChain = MCFixup::None;
+    Fixup.Next = MCFixup::None;
+    if (Fixup.Section == MCSymbol::text) {
+      Fixup.Inst = PendingInsts.push(Text.Insts, i);
+      if (Fixup.Modifier == MCExpr::kCALL) {
+        PendingInsts.push(Text.Insts, i + 1);
+      }
+    }
+    PendingFixups.push_back(Fixup);
   }
 
-  {
-    mkAlign(2);
-    Offsets.insert(".text", offset);
-    offset += TextOffset;
+  auto Size = Text.Size - StreamedText;
+  auto Bytes = std::make_unique_for_overwrite<uint8_t[]>(Size);
+
+  [[maybe_unused]] auto Encoded = encodeText(Text.Insts, Bytes.get());
+  utils_assert(Encoded == Size, "text size mismatch");
+
+  file.append(Bytes.get(), Size);
+  file.flush();
+  StreamedText = Text.Size;
+
+  Text.Insts.clear();
+  Fixups.clear();
+}
+
+void MCContext::patchText() {
+  const auto& Insts = Sections[MCSymbol::text].Insts;
+  if (Insts.empty()) {
+    return;
   }
 
-  {
-    mkAlign(1);
-    Offsets.insert(".data", offset);
-    offset += DataBuffer.size();
+  size_ty Size = 0;
+  for (Index i = 0; i < Insts.size(); ++i) {
+    Size += Insts.isCompressed(i) ? 2 : 4;
   }
 
-  {
-    mkAlign(1);
-    Offsets.insert(".bss", offset);
-    /// readelf: Section '.bss' has no data to dump.
+  auto Text = std::make_unique_for_overwrite<uint8_t[]>(Size);
+  encodeText(Insts, Text.get());
+
+  /// insts next to each other in .text, an auipc and its pair mostly, go
+  /// back in one pwrite
+  auto Base = Elf_Shdrs[MCSymbol::text].sh_offset;
+  size_ty RunBegin = 0, RunOffset = Insts.getOffset(0), Pos = 0;
+
+  for (Index i = 0; i < Insts.size(); ++i) {
+    if (Insts.getOffset(i) != RunOffset + (Pos - RunBegin)) {
+      file.pwrite(Text.get() + RunBegin, Pos - RunBegin, Base + RunOffset);
+      RunBegin = Pos;
+      RunOffset = Insts.getOffset(i);
+    }
+    Pos += Insts.isCompressed(i) ? 2 : 4;
   }
+  file.pwrite(Text.get() + RunBegin, Pos - RunBegin, Base + RunOffset);
+}
 
-  {
-    mkAlign(1);
-    Offsets.insert(".strtab", offset);
+void MCContext::mkSymTab() {
+  /// begin with none (local)
+  Elf_Syms.emplace_back(Elf64_Sym{});
+
+  /// sections(local)
+  for (uint32_t ndx = 1; ndx < Sections.size(); ++ndx) {
+    Elf64_Sym symbol = {};
+
+    symbol.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT);
+    symbol.st_shndx = static_cast<uint16_t>(ndx);
 
-    offset += StrTabBuffer.size();
+    Elf_Syms.emplace_back(std::move(symbol));
   }
 
-  unsigned local_syms = 1;
-  {
-    mkAlign(8);
-    Offsets.insert(".symtab", offset);
+  auto emit = [&](MCSymbol& Sym) {
+    Sym.SymtabIdx = static_cast<uint32_t>(Elf_Syms.size());
+    StrTab.add(Sym.Name);
 
-    /// begin with none (local)
     Elf64_Sym symbol = {};
+
+    symbol.st_info = ELF64_ST_INFO(Sym.Global || !Sym.Defined ? STB_GLOBAL
+                                                              : STB_LOCAL,
+                                   STT_NOTYPE);
+    symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT); // visibility
+    symbol.st_shndx =
+        static_cast<uint16_t>(Sym.Defined ? Sym.Section : MCSymbol::und);
+    symbol.st_value = Sym.Defined ? Sym.Value : 0;
+
     Elf_Syms.emplace_back(std::move(symbol));
+  };
+
+  /// labels(local), a .globl one is not declared as local
+  for (auto& Sym : Syms) {
+    if (Sym.isLocal() && (!DiscardLocals || Sym.Referenced)) {
+      emit(Sym);
+    }
+  }
+  LocalSyms = Elf_Syms.size();
+
+  /// globals, defined here or extern
+  for (auto& Sym : Syms) {
+    if (!Sym.isLocal()) {
+      emit(Sym);
+    }
+  }
 
-    /// sections(local)
-    const auto& sections = Offsets.keys();
-    for (size_ty i = 1; i < sections.size() - 1; ++i) {
-      Elf64_Sym symbol = {};
+  StrTab.finalize();
+  for (const auto& Sym : Syms) {
+    if (Sym.SymtabIdx) {
+      Elf_Syms[Sym.SymtabIdx].st_name = StrTab.getOffset(Sym.Name);
+    }
+  }
 
-      symbol.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
-      symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT);
-      symbol.st_shndx = i;
+  for (auto& Section : Sections) {
+    for (size_ty i = 0; i < Section.Relas.size(); ++i) {
+      auto& Rela = Section.Relas[i];
+      auto Sym = Section.RelaSyms[i];
+      auto Idx = Sym == MCFixup::None ? 0 : Syms[Sym].SymtabIdx;
+      Rela.r_info = ELF64_R_INFO(Idx, ELF64_R_TYPE(Rela.r_info));
+    }
+  }
+}
 
-      Elf_Syms.emplace_back(std::move(symbol));
-      ++local_syms;
+void MCContext::reloSym(const MCFixup& Fixup, int64_t offset) {
+  auto& Insts = Sections[Fixup.Section].Insts;
+  auto i = Fixup.Inst;
+
+  if (Fixup.Modifier == MCExpr::kCALL) {
+    /// the auipc takes the rounded upper bits, the jalr behind it the rest
+    auto Hi = (offset + 0x800) & ~int64_t(0xfff);
+    Insts.setImm(i, Hi);
+    Insts.setImm(i + 1, offset - Hi);
+  } else if (Fixup.hasModifier()) {
+    if (getModifierSize(Fixup.Modifier) == 20) {
+      /// lands in imm[31:12], rounded since the paired lo12 is signed
+      Insts.setImm(i, (offset + 0x800) & ~int64_t(0xfff));
+    } else {
+      Insts.setImm(i, utils::signIntCompress(offset, 12));
     }
+  } else {
+    // usually branch & jumps without any explicit modifier
+    Insts.setImm(i, offset);
+  }
+}
 
-    /// labels(local)
-    for (const auto& label : TextLabels.keys()) {
-      if (std::find_if(Symbols.begin(), Symbols.end(), [&](const auto& tuple) {
-            return label == std::get<0>(tuple);
-          }) != Symbols.end()) {
-        /// if a label will be declare as global, then avoid declare as local
-        continue;
-      }
+uint32_t MCContext::getReloType(const MCFixup& Fixup) const {
+  const auto& OpCode = Sections[Fixup.Section].Insts.getOpCode(Fixup.Inst);
+
+  if (!Fixup.hasModifier()) {
+    /// Relo type will rely on the instruction types
+    /// jmp / branch inst
+    /// TODO: to fit more relo type
+    return StringSwitch<uint32_t>(OpCode.name)
+        .BeginWith("J", static_cast<uint32_t>(R_RISCV_JAL))
+        .BeginWith("B", static_cast<uint32_t>(R_RISCV_BRANCH))
+        .BeginWith("C_J", static_cast<uint32_t>(R_RISCV_RVC_JUMP))
+        .BeginWith("C_B", static_cast<uint32_t>(R_RISCV_RVC_BRANCH))
+        .Error();
+  }
+
+  using ExprTy = MCExpr::ExprTy;
+
+  switch (Fixup.Modifier) {
+  case ExprTy::kInValid:
+    utils::fatal("invalid modifier");
+  case ExprTy::kLO:
+    return OpCode.imm_distribute == 1 ? R_RISCV_LO12_I : R_RISCV_LO12_S;
+  case ExprTy::kPCREL_LO:
+    return OpCode.imm_distribute == 1 ? R_RISCV_PCREL_LO12_I
+                                      : R_RISCV_PCREL_LO12_S;
+  case ExprTy::kHI:
+    return R_RISCV_HI20;
+  case ExprTy::kPCREL_HI:
+    return R_RISCV_PCREL_HI20;
+  case ExprTy::kGOT_PCREL_HI:
+    return R_RISCV_GOT_HI20;
+  case ExprTy::kTPREL_ADD:
+    return R_RISCV_TPREL_ADD;
+  case ExprTy::kTPREL_HI:
+    return R_RISCV_TPREL_HI20;
+  case ExprTy::kTLS_IE_PCREL_HI:
+    return R_RISCV_TLS_GOT_HI20;
+  case ExprTy::kTLS_GD_PCREL_HI:
+    return R_RISCV_TLS_GD_HI20;
+  case ExprTy::kCALL:
+    return R_RISCV_CALL_PLT;
+  }
+  utils::fatal("unknown modifier");
+}
+
+void MCContext::checkReach(const MCFixup& Fixup) const {
+  const auto& Insts = Sections[Fixup.Section].Insts;
+  auto Bits = shortReach(Insts.getOpCode(Fixup.Inst));
+  if (Fixup.hasModifier() || Bits == 0) {
+    return;
+  }
+
+  auto offset = static_cast<int64_t>(Insts.getOps(Fixup.Inst).Imm);
+  if (!fitsSigned(offset, Bits)) {
+    utils::fatal("branch out of range, a streamed .text cant relax");
+  }
+}
 
-      Elf64_Sym symbol = {};
+std::vector<bool> MCContext::fallenInto() const {
+  std::vector<uint32_t> Chain;
+  for (const auto& Sym : Syms) {
+    if (Sym.Function) {
+      Chain.push_back(Sym.Section);
+    }
+  }
+  std::sort(Chain.begin(), Chain.end());
 
-      symbol.st_name = StrTabBuffer.findOffset(label);
-      symbol.st_info = ELF64_ST_INFO(STB_LOCAL, STT_NOTYPE);
-      symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT);
-      symbol.st_shndx =
-          std::distance(sections.begin(),
-                        std::find(sections.begin(), sections.end(), ".text"));
+  /// .text comes first, nothing runs out of it if it was left empty
+  const auto& Text = Sections[MCSymbol::text];
+  bool Runs = Text.Size && fallsThrough(Text);
 
-      Elf_Syms.emplace_back(std::move(symbol));
-      ++local_syms;
+  std::vector<bool> Into(Sections.size());
+  for (auto Id : Chain) {
+    Into[Id] = Runs;
+    Runs = fallsThrough(Sections[Id]);
+  }
+  return Into;
+}
+
+void MCContext::foldText() {
+  struct Function {
+    uint32_t Section;
+    uint32_t Rank;
+    uint64_t Hash = 0;
+  };
+
+  /// a function that runs into the next one is that one as well, it never
+  /// folds. one run into by the one before may be kept, never dropped
+  auto Into = fallenInto();
+
+  std::vector<Function> Functions;
+  for (const auto& Sym : Syms) {
+    if (Sym.Function && Sym.Global && !fallsThrough(Sections[Sym.Section])) {
+      Functions.push_back(
+          {Sym.Section, Ordering ? Ordering->rank(Sym.Name) : 0});
     }
+  }
+  if (Functions.size() < 2) {
+    return;
+  }
+
+  /// of the copies the hottest is kept, the first of those
+  std::sort(Functions.begin(), Functions.end(),
+            [](const Function& L, const Function& R) {
+              return std::pair(L.Rank, L.Section) <
+                     std::pair(R.Rank, R.Section);
+            });
+
+  /// the fixups of each section, in inst order
+  std::vector<std::vector<uint32_t>> Refs(Sections.size());
+  for (uint32_t i = 0; i < Fixups.size(); ++i) {
+    Refs[Fixups[i].Section].push_back(i);
+  }
 
-    /// relo symbols(local)
-    for (const auto& [sym, ndx] : Symbols) {
-      Elf64_Sym symbol = {};
+  /// a label of the function itself by its offset, a copy has its own.
+  /// anything else by its id
+  auto target = [&](const MCFixup& Fixup) {
+    const auto& Sym = Syms[Fixup.Sym];
+    return Sym.Defined && Sym.Section == Fixup.Section
+               ? std::pair(true, static_cast<uint64_t>(Sym.Value))
+               : std::pair(false, static_cast<uint64_t>(Fixup.Sym));
+  };
 
-      symbol.st_name = StrTabBuffer.findOffset(sym);
-      symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
-      symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT); // visibility
-      symbol.st_shndx = ndx;
+  auto fixupKey = [&](const MCFixup& Fixup) {
+    return std::tuple(Fixup.Inst, Fixup.Modifier, bool(Fixup.Resolved),
+                      bool(Fixup.Relax), Fixup.Addend, target(Fixup));
+  };
 
-      Elf_Syms.emplace_back(std::move(symbol));
+  /// one pass over the columns of the insts, what the encoder reads, then
+  /// the .aligns and the fixups
+  auto hash = [&](Function& F) {
+    const auto& Section = Sections[F.Section];
+    const auto& Insts = Section.Insts;
+
+    uint64_t h = mix(Section.Size, Section.AssumedAlign);
+    for (Index i = 0; i < Insts.size(); ++i) {
+      auto Ops = Insts.getOps(i);
+      h = mix(h, Insts.getOpCode(i).index | uint64_t(Ops.Regs) << 16 |
+                     uint64_t(Ops.HasImm) << 48);
+      h = mix(h, Ops.Imm);
+    }
+    for (const auto& Pad : Section.Aligns) {
+      h = mix(h, Pad.Offset | uint64_t(Pad.Align) << 32);
     }
+    for (auto i : Refs[F.Section]) {
+      const auto& Fixup = Fixups[i];
+      auto [Local, Target] = target(Fixup);
+      h = mix(h, Fixup.Inst | uint64_t(Fixup.Modifier) << 32 |
+                     uint64_t(Local) << 40);
+      h = mix(h, Target);
+    }
+    F.Hash = h;
+  };
 
-    /// extern syms
+  if (FoldPool && FoldPool->size() > 1) {
+    auto Batch = Functions.size() / (FoldPool->size() * 4) + 1;
+    for (size_ty b = 0; b < Functions.size(); b += Batch) {
+      FoldPool->submit([&, b, Batch] {
+        auto e = std::min(b + Batch, Functions.size());
+        for (auto k = b; k < e; ++k) {
+          hash(Functions[k]);
+        }
+      });
+    }
+    FoldPool->wait();
+  } else {
+    std::for_each(Functions.begin(), Functions.end(), hash);
+  }
 
-    for (const auto& sym : ExternSymbols) {
-      Elf64_Sym symbol = {};
+  /// a hash only ever picks the candidates
+  auto same = [&](uint32_t A, uint32_t B) {
+    const auto& L = Sections[A];
+    const auto& R = Sections[B];
+    if (L.Size != R.Size || L.AssumedAlign != R.AssumedAlign ||
+        L.MaxAlign != R.MaxAlign || L.Insts.size() != R.Insts.size() ||
+        L.Aligns.size() != R.Aligns.size() ||
+        Refs[A].size() != Refs[B].size()) {
+      return false;
+    }
 
-      symbol.st_name = StrTabBuffer.findOffset(sym);
-      symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
-      symbol.st_other = ELF64_ST_VISIBILITY(STV_DEFAULT); // visibility
-      symbol.st_shndx = und;
+    for (Index i = 0; i < L.Insts.size(); ++i) {
+      auto LOps = L.Insts.getOps(i);
+      auto ROps = R.Insts.getOps(i);
+      if (L.Insts.getOpCode(i).index != R.Insts.getOpCode(i).index ||
+          L.Insts.getOffset(i) != R.Insts.getOffset(i) ||
+          std::tuple(LOps.Regs, LOps.NumRegs, LOps.HasImm, LOps.Imm) !=
+              std::tuple(ROps.Regs, ROps.NumRegs, ROps.HasImm, ROps.Imm)) {
+        return false;
+      }
+    }
 
-      Elf_Syms.emplace_back(std::move(symbol));
+    for (size_ty k = 0; k < L.Aligns.size(); ++k) {
+      const auto& LPad = L.Aligns[k];
+      const auto& RPad = R.Aligns[k];
+      if (std::tuple(LPad.Offset, LPad.Size, LPad.Align, LPad.Relax,
+                     LPad.MaxSkip) != std::tuple(RPad.Offset, RPad.Size,
+                                                 RPad.Align, RPad.Relax,
+                                                 RPad.MaxSkip)) {
+        return false;
+      }
+    }
+
+    for (size_ty k = 0; k < Refs[A].size(); ++k) {
+      if (fixupKey(Fixups[Refs[A][k]]) != fixupKey(Fixups[Refs[B][k]])) {
+        return false;
+      }
     }
+    return true;
+  };
 
-    offset += (Elf_Syms.size()) * sizeof(Elf64_Sym);
+  /// where the symbols of each section go
+  std::vector<uint32_t> Dest(Sections.size());
+  std::iota(Dest.begin(), Dest.end(), 0);
+
+  std::unordered_map<uint64_t, std::vector<uint32_t>> Kept;
+  bool Folded = false;
+  for (const auto& F : Functions) {
+    auto& Candidates = Kept[F.Hash];
+    auto It = std::find_if(Candidates.begin(), Candidates.end(),
+                           [&](uint32_t Id) { return same(Id, F.Section); });
+    if (It == Candidates.end() || Into[F.Section]) {
+      Candidates.push_back(F.Section);
+    } else {
+      Dest[F.Section] = *It;
+      Folded = true;
+    }
+  }
+  if (!Folded) {
+    return;
   }
 
-  {
-    mkAlign(8);
-    Offsets.insert(".rela.text", offset);
-    offset += (Elf_Relas.size()) * sizeof(Elf64_Rela);
+  /// an alias no longer starts a section of its own
+  for (auto& Sym : Syms) {
+    Sym.FixupChain = MCFixup::None;
+    if (Sym.Defined && Dest[Sym.Section] != Sym.Section) {
+      Sym.Section = Dest[Sym.Section];
+      Sym.Function = false;
+    }
   }
 
-  {
-    mkAlign(1);
-    Offsets.insert(".shstrtab", offset);
+  /// the fixups of the copies go with them, the chains are done with
+  std::vector<MCFixup> Left;
+  std::vector<uint32_t> NewIdx(Fixups.size(), MCFixup::None);
+  for (uint32_t i = 0; i < Fixups.size(); ++i) {
+    if (Dest[Fixups[i].Section] == Fixups[i].Section) {
+      NewIdx[i] = static_cast<uint32_t>(Left.size());
+      Left.push_back(Fixups[i]);
+      Left.back().Next = MCFixup::None;
+    }
+  }
+  Fixups = std::move(Left);
 
-    /// gather .shstrtab
-    /// include names of each section
-    SHStrTabBuffer << '\x00';
-    SHStrTabBuffer << ".text" << '\x00';
-    SHStrTabBuffer << ".data" << '\x00';
-    SHStrTabBuffer << ".bss" << '\x00';
-    SHStrTabBuffer << ".strtab" << '\x00';
-    SHStrTabBuffer << ".symtab" << '\x00';
-    SHStrTabBuffer << ".rela.text" << '\x00';
-    SHStrTabBuffer << ".shstrtab" << '\x00';
+  std::vector<uint32_t> Order;
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    if (Dest[Id] != Id) {
+      continue;
+    }
+    Order.push_back(Id);
 
-    offset += SHStrTabBuffer.size();
+    for (auto& Frag : Sections[Id].Frags) {
+      if (Frag.Kind == MCFragment::kRelaxable) {
+        Frag.Ref = NewIdx[Frag.Ref];
+      }
+    }
   }
 
-  {
-    mkAlign(8);
-    Offsets.insert("section header table", offset);
+  /// parsing is over
+  Cur = TextTail = MCSymbol::text;
+  renumberSections(Order);
+}
+
+void MCContext::orderText() {
+  struct Function {
+    uint32_t Section;
+    uint32_t Rank;
+    const MCSymbol* Sym;
+  };
+
+  /// in source order, their sections were made in it
+  std::vector<Function> Functions;
+  for (const auto& Sym : Syms) {
+    if (Sym.Function) {
+      Functions.push_back(
+          {Sym.Section, Ordering ? Ordering->rank(Sym.Name) : 0, &Sym});
+    }
+  }
+  std::sort(Functions.begin(), Functions.end(),
+            [](const Function& L, const Function& R) {
+              return L.Section < R.Section;
+            });
+
+  /// a function that runs into the next one takes it along, the run moves
+  /// as one, as hot as the hottest of it. a run .text runs into stays first
+  auto Into = fallenInto();
+  for (std::size_t b = 0, e; b < Functions.size(); b = e) {
+    auto Rank = b == 0 && Into[Functions[b].Section] ? 0 : Functions[b].Rank;
+    for (e = b + 1; e < Functions.size() && Into[Functions[e].Section]; ++e) {
+      Rank = std::min(Rank, Functions[e].Rank);
+    }
+    for (auto k = b; k < e; ++k) {
+      Functions[k].Rank = Rank;
+    }
   }
 
-  {
-    hdr.e_shoff = offset;
+  std::vector<uint32_t> Slots(Functions.size());
+  std::transform(Functions.begin(), Functions.end(), Slots.begin(),
+                 [](const Function& F) { return F.Section; });
+
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [](const Function& L, const Function& R) {
+                     return L.Rank < R.Rank;
+                   });
+
+  /// parsing is over
+  Cur = TextTail = MCSymbol::text;
+
+  auto everySection = [&] {
+    std::vector<uint32_t> Order(Sections.size() - 1);
+    std::iota(Order.begin(), Order.end(), 1);
+    return Order;
+  };
+
+  if (FunctionSections) {
+    auto Order = everySection();
+
+    /// the sections of the functions swap places, the linker keeps them
+    for (std::size_t i = 0; i < Functions.size(); ++i) {
+      auto& Section = Sections[Functions[i].Section];
+      Order[Slots[i] - 1] = Functions[i].Section;
+
+      if (SplitCold && Functions[i].Rank == MCOrdering::Cold) {
+        Section.Name = ".text.unlikely." + Functions[i].Sym->Name;
+      }
+    }
+
+    renumberSections(Order);
+    return;
+  }
+
+  const auto& Text = Sections[MCSymbol::text];
+  auto ColdId = SplitCold ? addSection(".text.unlikely", Text.Type, Text.Flags)
+                          : MCSymbol::text;
+
+  auto Order = everySection();
+
+  /// where each section went, and where it starts there
+  std::vector<uint32_t> Dest(Sections.size());
+  std::iota(Dest.begin(), Dest.end(), 0);
+  std::vector<size_ty> Bases(Sections.size());
+  std::vector<Index> InstBases(Sections.size());
+
+  for (const auto& F : Functions) {
+    auto ToId = F.Rank == MCOrdering::Cold ? ColdId : MCSymbol::text;
+    auto& To = Sections[ToId];
+    auto& From = Sections[F.Section];
+
+    /// a function keeps its offset modulo what its insts and .aligns took
+    /// for granted, the pad is resized by layout as any other
+    if (From.AssumedAlign > instAlign(C_NOP)) {
+      alignSection(To, From.AssumedAlign, false,
+                   From.Insts.size() ? From.Insts.getLoc(0) : SourceOffset());
+    }
+
+    auto Base = Bases[F.Section] = To.Size;
+    InstBases[F.Section] = static_cast<Index>(To.Insts.size());
+    auto AlignBase = static_cast<uint32_t>(To.Aligns.size());
+    Dest[F.Section] = ToId;
+
+    To.Insts.append(From.Insts, Base);
+    To.Size += From.Size;
+
+    for (auto Align : From.Aligns) {
+      Align.Offset += static_cast<uint32_t>(Base);
+      To.Aligns.push_back(Align);
+    }
+
+    for (auto Frag : From.Frags) {
+      if (Frag.Kind == MCFragment::kData) {
+        continue;
+      }
+      Frag.Start = Frag.Offset = Frag.Start + static_cast<uint32_t>(Base);
+      Frag.Ref += Frag.Kind == MCFragment::kAlign ? AlignBase : 0;
+      To.Frags.add(Frag);
+    }
+
+    To.AssumedAlign = std::lcm(To.AssumedAlign, From.AssumedAlign);
+    To.MaxAlign = std::max(To.MaxAlign, From.MaxAlign);
+  }
+
+  std::erase_if(Order, [&](uint32_t Id) { return Dest[Id] != Id; });
+
+  /// the chains are done with, the fixups are reordered below
+  for (auto& Sym : Syms) {
+    Sym.FixupChain = MCFixup::None;
+    if (Sym.Defined && Dest[Sym.Section] != Sym.Section) {
+      Sym.Value += Bases[Sym.Section];
+      Sym.Section = Dest[Sym.Section];
+    }
+  }
+
+  for (auto& Fixup : Fixups) {
+    Fixup.Next = MCFixup::None;
+    if (Dest[Fixup.Section] != Fixup.Section) {
+      Fixup.Inst += InstBases[Fixup.Section];
+      Fixup.Section = static_cast<uint16_t>(Dest[Fixup.Section]);
+    }
+
+    const auto& Sym = Syms[Fixup.Sym];
+    if (!Fixup.Resolved && Sym.Defined && Sym.Section == Fixup.Section) {
+      reloTextSym(Fixup, Sym.Value);
+      Fixup.Resolved = true;
+    }
+  }
+
+  /// Relo() takes the fixups of a section in offset order, the branches of
+  /// the fragments follow theirs
+  std::vector<uint32_t> Perm(Fixups.size());
+  std::iota(Perm.begin(), Perm.end(), 0);
+  std::stable_sort(Perm.begin(), Perm.end(), [&](uint32_t L, uint32_t R) {
+    return std::pair(Fixups[L].Section, Fixups[L].Inst) <
+           std::pair(Fixups[R].Section, Fixups[R].Inst);
+  });
+
+  std::vector<MCFixup> Sorted;
+  std::vector<uint32_t> NewIdx(Fixups.size());
+  Sorted.reserve(Fixups.size());
+  for (auto i : Perm) {
+    NewIdx[i] = static_cast<uint32_t>(Sorted.size());
+    Sorted.push_back(Fixups[i]);
+  }
+  Fixups = std::move(Sorted);
 
-    /// empty section hdr
-    {
-      Elf64_Shdr shdr = {};
-      shdr.sh_type = SHT_NULL;
-      Elf_Shdrs.emplace_back(std::move(shdr));
+  for (auto& Section : Sections) {
+    for (auto& Frag : Section.Frags) {
+      if (Frag.Kind == MCFragment::kRelaxable) {
+        Frag.Ref = NewIdx[Frag.Ref];
+      }
     }
+  }
+
+  renumberSections(Order);
+}
+
+void MCContext::renumberSections(const std::vector<uint32_t>& Order) {
+  std::vector<uint32_t> NewIds(Sections.size());
+  std::deque<MCSection> Kept;
+  Kept.push_back(std::move(Sections.front()));
+
+  for (auto Id : Order) {
+    NewIds[Id] = static_cast<uint32_t>(Kept.size());
+    Kept.push_back(std::move(Sections[Id]));
+  }
+  utils_assert(NewIds[MCSymbol::text] == MCSymbol::text &&
+                   NewIds[MCSymbol::data] == MCSymbol::data &&
+                   NewIds[MCSymbol::bss] == MCSymbol::bss,
+               ".text, .data and .bss keep their ids");
+
+  Sections = std::move(Kept);
+
+  /// the names moved along
+  SectionIds.clear();
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    SectionIds.emplace(Sections[Id].Name, Id);
+  }
+
+  for (auto& Sym : Syms) {
+    Sym.Section = NewIds[Sym.Section];
+  }
+  for (auto& Fixup : Fixups) {
+    Fixup.Section = static_cast<uint16_t>(NewIds[Fixup.Section]);
+  }
+  Cur = NewIds[Cur];
+  TextTail = NewIds[TextTail];
+}
 
-    auto SectionHeader = [&](StringRef name, uint32_t type, uint64_t flag,
-                             uint64_t size, uint64_t alignment,
-                             uint32_t link = 0, uint32_t info = 0,
-                             uint64_t entsize = 0) {
-      Elf64_Shdr shdr = {};
+void MCContext::autoAlign() {
+  /// offset and alignment wanted there, by section id
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> Wanted(
+      Sections.size());
+
+  if (AlignFunctions) {
+    for (const auto& Sym : Syms) {
+      if (Sym.Defined && (Sym.Global || Sym.Function) &&
+          Sections[Sym.Section].Kind == MCSection::kText) {
+        Wanted[Sym.Section].emplace_back(static_cast<uint32_t>(Sym.Value),
+                                         static_cast<uint32_t>(AlignFunctions));
+      }
+    }
+  }
 
-      auto offset = Offsets.find(name);
-      utils_assert(offset, "cant find offset of this section");
+  /// a resolved branch or jump back to its own section heads a loop, a jal
+  /// that links is a call
+  if (AlignLoops) {
+    for (const auto& Fixup : Fixups) {
+      if (!Fixup.Resolved || Fixup.hasModifier()) {
+        continue;
+      }
 
-      shdr.sh_name = SHStrTabBuffer.findOffset(name);
-      shdr.sh_type = type;
-      shdr.sh_flags = flag;
-      shdr.sh_addr = 0;
-      shdr.sh_offset = *offset;
-      shdr.sh_size = size;
-      shdr.sh_addralign = alignment;
+      const auto& Insts = Sections[Fixup.Section].Insts;
+      auto [Wide, Ops] =
+          widen(Insts.getOpCode(Fixup.Inst), Insts.getOps(Fixup.Inst));
+      auto Bits = shortReach(*Wide);
+      bool Jump =
+          Bits == 13 || (Bits == 21 && static_cast<MCReg>(Ops.Regs) == X0);
+
+      auto Target = Syms[Fixup.Sym].Value;
+      if (Jump && Target <= Insts.getOffset(Fixup.Inst)) {
+        Wanted[Fixup.Section].emplace_back(static_cast<uint32_t>(Target),
+                                           static_cast<uint32_t>(AlignLoops));
+      }
+    }
+  }
 
-      shdr.sh_entsize = entsize;
-      shdr.sh_link = link;
-      shdr.sh_info = info;
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    auto& Want = Wanted[Id];
+    auto& Section = Sections[Id];
+    const auto& Insts = Section.Insts;
+    std::sort(Want.begin(), Want.end());
+
+    /// the largest alignment at each offset. the start of the section only
+    /// needs sh_addralign, nothing is behind the end
+    std::vector<std::pair<uint32_t, uint32_t>> Pads;
+    for (auto [Offset, Align] : Want) {
+      if (Offset == 0) {
+        Section.noteAlign(Align);
+      } else if (Offset < Section.Size) {
+        if (!Pads.empty() && Pads.back().first == Offset) {
+          Pads.back().second = Align;
+        } else {
+          Pads.emplace_back(Offset, Align);
+        }
+        Section.noteAlign(Align);
+      }
+    }
+    if (Pads.empty()) {
+      continue;
+    }
 
-      Elf_Shdrs.emplace_back(std::move(shdr));
+    /// a new pad goes in front of an .align at the same offset, both keep
+    /// the offset order. it reports at the inst it pads
+    std::vector<MCTextAlign> Aligns;
+    std::vector<uint32_t> AlignIdx(Section.Aligns.size());
+    std::vector<uint32_t> PadIdx(Pads.size());
+    Index i = 0;
+    size_ty a = 0;
+
+    auto keepAligns = [&](size_ty Offset) {
+      for (; a < Section.Aligns.size() && Section.Aligns[a].Offset < Offset;
+           ++a) {
+        AlignIdx[a] = static_cast<uint32_t>(Aligns.size());
+        Aligns.push_back(Section.Aligns[a]);
+      }
     };
 
-    /// .text
-    SectionHeader(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, TextOffset,
-                  2);
+    for (size_ty p = 0; p < Pads.size(); ++p) {
+      auto [Offset, Align] = Pads[p];
+      keepAligns(Offset);
+      for (; i + 1 < Insts.size() && Insts.getOffset(i) < Offset; ++i) {
+      }
 
-    /// .data
-    SectionHeader(".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE,
-                  DataBuffer.size(), 1);
+      PadIdx[p] = static_cast<uint32_t>(Aligns.size());
+      Aligns.push_back({Offset, 0, Align, false, Insts.getLoc(i)});
+    }
+    keepAligns(SIZE_MAX);
 
-    /// .bss
-    SectionHeader(".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE, 0, 1);
+    /// the kData in between are made again by add()
+    MCFragmentList Frags;
+    size_ty p = 0;
 
-    /// .strtab
-    SectionHeader(".strtab", SHT_STRTAB, 0, StrTabBuffer.size(), 1);
+    auto addPads = [&](size_ty Start) {
+      for (; p < Pads.size() && Pads[p].first <= Start; ++p) {
+        Frags.add({MCFragment::kAlign, Pads[p].first, 0, PadIdx[p],
+                   Pads[p].second});
+      }
+    };
 
-    /// .symtab: link to .strtab
-    SectionHeader(".symtab", SHT_SYMTAB, 0,
-                  this->Elf_Syms.size() * sizeof(Elf64_Sym), 8, 4, local_syms,
-                  sizeof(Elf64_Sym));
+    for (auto Frag : Section.Frags) {
+      if (Frag.Kind == MCFragment::kData) {
+        continue;
+      }
 
-    /// .rela.text: link to .symtab
-    SectionHeader(".rela.text", SHT_RELA, SHF_INFO_LINK,
-                  Elf_Relas.size() * sizeof(Elf64_Rela), 8, 5, 1,
-                  sizeof(Elf64_Sym));
+      addPads(Frag.Start);
+      if (Frag.Kind == MCFragment::kAlign) {
+        Frag.Ref = AlignIdx[Frag.Ref];
+      }
+      Frags.add(Frag);
+    }
+    addPads(SIZE_MAX);
 
-    /// .shstrtab
-    SectionHeader(".shstrtab", SHT_STRTAB, 0, SHStrTabBuffer.size(), 1);
+    Section.Aligns = std::move(Aligns);
+    Section.Frags = std::move(Frags);
   }
 }
 
-void MCContext::writein() {
+void MCContext::layoutSection(MCSection& Section, std::vector<Index>& Moved) {
+  auto& Frags = Section.Frags;
+  auto& Insts = Section.Insts;
 
-  this->mkStrTab();
+  if (Frags.empty()) {
+    return;
+  }
+  Frags.finish(static_cast<uint32_t>(Section.Size));
+
+  /// under rvc a branch or jump on a label starts out in its C form, and
+  /// grows back into the 32-bit one as a written C form would. under relax
+  /// the linker moves its label, it keeps the form it was written in
+  for (auto& Frag : Frags) {
+    if (Frag.Kind != MCFragment::kRelaxable) {
+      continue;
+    }
 
-  this->Relo();
+    const auto& Fixup = Fixups[Frag.Ref];
+    if (Fixup.RVC && !Fixup.Relax && Fixup.Resolved &&
+        narrow(Insts.getOpCode(Fixup.Inst), Insts.getOps(Fixup.Inst)).first) {
+      Frag.Shape = MCFragment::kNarrow;
+      Frag.Size = MCFragment::sizeOf(MCFragment::kNarrow);
+    }
+  }
 
-  this->Ehdr_Shdr();
+  /// the pads of autoAlign() are still empty
+  Frags.layoutFrom(0);
+
+  /// each pass sizes the branches against the layout of the last one, then
+  /// lays out again from the first that grew. a form only ever grows, so
+  /// this settles, the pads follow the forms
+  for (;;) {
+    auto First = Frags.count();
+
+    for (std::size_t k = 0; k < Frags.count(); ++k) {
+      auto& Frag = Frags[k];
+      if (Frag.Kind != MCFragment::kRelaxable ||
+          Frag.Shape == MCFragment::kOverCall ||
+          Frag.Shape == MCFragment::kCall || !Fixups[Frag.Ref].Resolved) {
+        continue;
+      }
+
+      const auto& Fixup = Fixups[Frag.Ref];
+      const auto& OpCode = Insts.getOpCode(Fixup.Inst);
+      auto [Wide, Ops] = widen(OpCode, Insts.getOps(Fixup.Inst));
+      auto Bits = shortReach(*Wide);
+
+      auto From = Frag.Offset + Frag.jumpAt();
+      auto To = Frags.moved(Syms[Fixup.Sym].Value);
+      auto offset = static_cast<int64_t>(To - From);
+
+      auto Reach = Frag.Shape == MCFragment::kNarrow
+                       ? shortReach(*narrow(OpCode, Ops).first)
+                   : Frag.Shape == MCFragment::kShort ? shortReach(OpCode)
+                   : Frag.Shape == MCFragment::kWide  ? Bits
+                                                      : 21;
+      if (fitsSigned(offset, Reach)) {
+        continue;
+      }
+
+      /// a C form takes its 32-bit one first, a narrowed one the form it
+      /// was written in, a branch then jumps over a jal x0
+      if (Frag.Shape == MCFragment::kNarrow) {
+        Frag.Shape = MCFragment::kShort;
+      } else if (Frag.Shape == MCFragment::kShort && OpCode.isCompressed()) {
+        Frag.Shape = MCFragment::kWide;
+      } else if (Bits == 21) {
+        Frag.Shape = MCFragment::kCall;
+      } else {
+        Frag.Shape = Frag.Shape == MCFragment::kOverJal
+                         ? MCFragment::kOverCall
+                         : MCFragment::kOverJal;
+      }
+
+      /// past the reach of a jal only auipc+jalr is left. a jal that links
+      /// keeps its target in rd, a plain jump or branch has to take t1
+      /// from code that may still need it, relax says that is fine
+      bool TakesT1 = Frag.Shape == MCFragment::kOverCall ||
+                     (Frag.Shape == MCFragment::kCall &&
+                      static_cast<MCReg>(Ops.Regs) == X0);
+      if (TakesT1 && !Fixup.Relax) {
+        utils::fatal("branch or jump out of the reach of jal, its "
+                     "expansion clobbers t1: use tail, or .option relax "
+                     "to allow it");
+      }
+
+      Frag.Size = Frag.Shape == MCFragment::kShort
+                      ? Frag.ParsedSize
+                      : MCFragment::sizeOf(Frag.Shape);
+      First = std::min(First, k);
+    }
+
+    if (First == Frags.count()) {
+      break;
+    }
+    Frags.layoutFrom(First);
+  }
+
+  bool Resized = std::any_of(
+      Frags.begin(), Frags.end(),
+      [](const MCFragment& Frag) { return Frag.Size != Frag.ParsedSize; });
+  if (!Resized) {
+    return;
+  }
 
-  size_ty curOffset = 0;
+  /// lay the insts out once, fragment by fragment
+  MCInstStore Laid;
+  Moved.resize(Insts.size());
 
-  auto streamWriteIn = [&](const char* data, size_ty n) {
-    this->file.write(data, n);
-    curOffset += n;
+  auto call = [&](MCReg Rd, size_ty Offset, SourceOffset Loc) {
+    /// a plain jump has no rd to spare, t1 is the scratch as for tail. the
+    /// imms are set with the other fixups
+    auto Scratch = Rd == X0 ? T1 : Rd;
+
+    auto i = Laid.push(AUIPC, {Scratch, 1, true, 0}, Offset, Loc);
+    Laid.push(JALR, {Rd | uint32_t(Scratch) << 8, 2, true, 0}, Offset + 4, Loc);
+    return i;
   };
 
-  auto padSection = [&](size_ty offset) {
-    /// pad current size to offset
-    std::vector<char> buffer(offset - curOffset, '\x00');
-    streamWriteIn(buffer.data(), buffer.size());
+  auto copy = [&](Index i, size_ty Offset) {
+    Moved[i] = Laid.push(Insts, i);
+    Laid.setOffset(Moved[i], Offset);
   };
 
-  /// elf header
-  {
-    streamWriteIn((char*)&this->Elf_Ehdr, sizeof(Elf64_Ehdr));
+  Index i = 0;
+  for (const auto& Frag : Frags) {
+    auto End = Frag.Start + Frag.ParsedSize;
+
+    switch (Frag.Kind) {
+    case MCFragment::kData:
+      for (; i < Insts.size() && Insts.getOffset(i) < End; ++i) {
+        copy(i, Insts.getOffset(i) - Frag.Start + Frag.Offset);
+      }
+      break;
+    case MCFragment::kAlign:
+      /// its old nops are dropped for the new ones
+      fillNops(Laid, Frag.Offset, Frag.Size, Section.Aligns[Frag.Ref].Loc);
+      for (; i < Insts.size() && Insts.getOffset(i) < End; ++i) {
+      }
+      break;
+    case MCFragment::kRelaxable: {
+      /// a C form grows from its 32-bit one
+      auto [Wide, Ops] = widen(Insts.getOpCode(i), Insts.getOps(i));
+      auto Loc = Insts.getLoc(i);
+      auto Offset = Frag.Offset;
+
+      if (Frag.Shape == MCFragment::kNarrow) {
+        auto [C, COps] = narrow(*Wide, Ops);
+        Moved[i] = Laid.push(*C, COps, Offset, Loc);
+      } else if (Frag.Shape == MCFragment::kShort) {
+        copy(i, Offset);
+      } else if (Frag.Shape == MCFragment::kWide) {
+        Moved[i] = Laid.push(*Wide, Ops, Offset, Loc);
+      } else if (Frag.Shape == MCFragment::kCall) {
+        Moved[i] = call(static_cast<MCReg>(Ops.Regs), Offset, Loc);
+      } else {
+        /// skip the jump when the condition does not hold, the fixup moves
+        /// on to the jump
+        Ops.Imm = Frag.Size;
+        Laid.push(invertBranch(*Wide), Ops, Offset, Loc);
+        Moved[i] = Frag.Shape == MCFragment::kOverJal
+                       ? Laid.push(JAL, {X0, 1, true, 0}, Offset + 4, Loc)
+                       : call(X0, Offset + 4, Loc);
+      }
+      ++i;
+    } break;
+    }
   }
 
-  /// .text
-  {
-    padSection(*this->Offsets.find(".text"));
+  for (auto& Pad : Section.Aligns) {
+    Pad.Offset = static_cast<uint32_t>(Frags.moved(Pad.Offset));
+  }
 
-    for (const auto& inst : this->Insts) {
-      auto encode = inst.makeEncoding();
-      streamWriteIn((char*)&encode, inst.isCompressed() ? 2 : 4);
+  /// a pad parsed empty starts where the insts behind it do, it keeps its
+  /// own place
+  for (const auto& Frag : Frags) {
+    if (Frag.Kind == MCFragment::kAlign) {
+      Section.Aligns[Frag.Ref].Offset = Frag.Offset;
+      Section.Aligns[Frag.Ref].Size = Frag.Size;
+    } else if (Frag.Shape == MCFragment::kCall ||
+               Frag.Shape == MCFragment::kOverCall) {
+      Fixups[Frag.Ref].Modifier = MCExpr::kCALL;
     }
   }
 
-  /// .data
-  {
-    padSection(*this->Offsets.find(".data"));
-    streamWriteIn((const char*)DataBuffer.data(), DataBuffer.size());
+  Insts = std::move(Laid);
+  Section.Size = Frags.size();
+}
+
+void MCContext::layoutText() {
+  if (AlignFunctions || AlignLoops) {
+    autoAlign();
   }
 
-  /// .bss
-  {
-    padSection(*this->Offsets.find(".bss"));
-    std::vector<char> buffer(BssSize, '\x00');
-    streamWriteIn(buffer.data(), buffer.size());
+  /// indexed by section id, empty for the ones that kept their layout
+  std::vector<std::vector<Index>> Moved(Sections.size());
+
+  bool Resized = false;
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    if (Sections[Id].Kind == MCSection::kText) {
+      layoutSection(Sections[Id], Moved[Id]);
+      Resized |= !Moved[Id].empty();
+    }
+  }
+  if (!Resized) {
+    return;
   }
 
-  /// .strtab
-  {
-    padSection(*this->Offsets.find(".strtab"));
-    streamWriteIn((const char*)StrTabBuffer.data(), StrTabBuffer.size());
+  for (auto& Sym : Syms) {
+    if (Sym.Defined && !Moved[Sym.Section].empty()) {
+      Sym.Value = Sections[Sym.Section].Frags.moved(Sym.Value);
+    }
   }
 
-  /// .symtab
-  {
-    padSection(*this->Offsets.find(".symtab"));
+  /// every resolved imm is redone, an expanded fixup names its jump now
+  for (auto& Fixup : Fixups) {
+    const auto& Map = Moved[Fixup.Section];
+    if (Map.empty()) {
+      continue;
+    }
 
-    for (auto& symbol : this->Elf_Syms) {
-      streamWriteIn((char*)&symbol, sizeof(Elf64_Sym));
+    Fixup.Inst = Map[Fixup.Inst];
+    if (Fixup.Resolved) {
+      reloTextSym(Fixup, Syms[Fixup.Sym].Value);
     }
   }
+}
 
-  /// .rela.text
-  {
-    padSection(*this->Offsets.find(".rela.text"));
+void MCContext::Relo() {
+  /// relax .aligns go in by offset between the fixups of their section, the
+  /// next one of each section
+  std::vector<size_ty> NextAlign(Sections.size());
+
+  auto alignsBefore = [&](uint32_t Id, size_ty Offset) {
+    auto& Section = Sections[Id];
+    auto& a = NextAlign[Id];
+
+    for (; a < Section.Aligns.size() && Section.Aligns[a].Offset <= Offset;
+         ++a) {
+      const auto& Pad = Section.Aligns[a];
+      if (!Pad.Relax || Pad.Size == 0) {
+        continue;
+      }
+
+      Elf64_Rela Rela = {};
+      Rela.r_offset = Pad.Offset;
+      Rela.r_info = ELF64_R_INFO(0, R_RISCV_ALIGN);
+      Rela.r_addend = Pad.Size;
+
+      Section.Relas.emplace_back(std::move(Rela));
+      Section.RelaSyms.push_back(MCFixup::None);
+    }
+  };
+
+  for (const auto& Fixup : Fixups) {
+    if (Fixup.Resolved && !Fixup.Relax) {
+      continue;
+    }
+
+    auto& Sym = Syms[Fixup.Sym];
+    bool Local = Fixup.Resolved;
+
+    /// only a streamed fixup can still meet a label of its section here,
+    /// any other was patched by its chain
+    if (!Local && Sym.Defined && Sym.Section == Fixup.Section) {
+      reloTextSym(Fixup, Sym.Value);
+      checkReach(Fixup);
+      if (!Fixup.Relax) {
+        continue;
+      }
+      Local = true;
+    }
+
+    /// else: symbols of other sections or extern configure Elf_Rela, so do
+    /// the labels of a relax fixup, the linker may move them. the symbol
+    /// index is filled in by mkSymTab
+    Sym.Referenced = true;
+
+    auto& Section = Sections[Fixup.Section];
+    auto Offset = Section.Insts.getOffset(Fixup.Inst);
+    alignsBefore(Fixup.Section, Offset);
+
+    Elf64_Rela Rela = {};
+    Rela.r_offset = Offset;
+    Rela.r_info = ELF64_R_INFO(0, getReloType(Fixup));
+    Rela.r_addend = Fixup.Addend;
+
+    Section.Relas.push_back(Rela);
+    Section.RelaSyms.push_back(Fixup.Sym);
+
+    /// the sequence may be shrunk by the linker
+    if (Fixup.Relax && Fixup.hasModifier()) {
+      Rela.r_info = ELF64_R_INFO(0, R_RISCV_RELAX);
+      Rela.r_addend = 0;
+
+      Section.Relas.emplace_back(std::move(Rela));
+      Section.RelaSyms.push_back(MCFixup::None);
+    }
 
-    for (auto& relo : this->Elf_Relas) {
-      streamWriteIn((char*)&relo, sizeof(Elf64_Rela));
+    if (!Local) {
+      reloSym(Fixup, 0ll);
     }
   }
 
-  /// .shstrtab
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    alignsBefore(Id, Sections[Id].Size);
+  }
+}
+
+void MCContext::Ehdr_Shdr() {
+  auto& hdr = this->Elf_Ehdr;
+
+  /// magic number
+  std::memcpy(hdr.e_ident,
+              "\x7f"
+              "ELF",
+              4);
+  hdr.e_ident[EI_CLASS] = ELFCLASS64;
+  hdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  hdr.e_ident[EI_VERSION] = EV_CURRENT;
+  hdr.e_ident[EI_OSABI] = ELFOSABI_NONE; // none
+
+  hdr.e_type = ET_REL;
+  hdr.e_machine = EM_RISCV;
+  hdr.e_version = EV_CURRENT;
+  hdr.e_flags = EF_RISCV_RVC | EF_RISCV_FLOAT_ABI_DOUBLE;
+  hdr.e_ehsize = sizeof(std::decay_t<decltype(hdr)>);
+  hdr.e_shentsize = sizeof(Elf64_Shdr);
+
+  /// <void> <sections by id> .strtab .symtab <.rela of each> .shstrtab, the
+  /// names go into .shstrtab in that order
+  std::vector<std::string> RelaNames;
+  SmallVector<uint32_t, 8> RelaOf; // section ids
+
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    const auto& Section = Sections[Id];
+    if (Id == MCSymbol::text || !Section.Relas.empty()) {
+      RelaOf.push_back(Id);
+      RelaNames.push_back(".rela" + Section.Name);
+    }
+  }
+
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    SHStrTab.add(Sections[Id].Name);
+  }
+  SHStrTab.add(".strtab");
+  SHStrTab.add(".symtab");
+  for (const auto& Name : RelaNames) {
+    SHStrTab.add(Name);
+  }
+  SHStrTab.add(".shstrtab");
+  SHStrTab.finalize();
+
+  /// estimate the offset to the section header table
+  size_ty offset = sizeof(std::decay_t<decltype(hdr)>);
+  auto mkAlign = [&](size_ty alignment) {
+    offset += (alignment - (offset % alignment)) % alignment;
+  };
+
+  /// empty section hdr
   {
-    padSection(*this->Offsets.find(".shstrtab"));
-    streamWriteIn((const char*)SHStrTabBuffer.data(), SHStrTabBuffer.size());
+    Elf64_Shdr shdr = {};
+    shdr.sh_type = SHT_NULL;
+    Elf_Shdrs.emplace_back(std::move(shdr));
+  }
+
+  auto SectionHeader = [&](StringRef name, uint32_t type, uint64_t flag,
+                           uint64_t size, uint64_t alignment,
+                           uint32_t link = 0, uint32_t info = 0,
+                           uint64_t entsize = 0) {
+    Elf64_Shdr shdr = {};
+
+    shdr.sh_name = SHStrTab.getOffset(name);
+    shdr.sh_type = type;
+    shdr.sh_flags = flag;
+    shdr.sh_addr = 0;
+    shdr.sh_offset = offset;
+    shdr.sh_size = size;
+    shdr.sh_addralign = alignment;
+
+    shdr.sh_entsize = entsize;
+    shdr.sh_link = link;
+    shdr.sh_info = info;
+
+    Elf_Shdrs.emplace_back(std::move(shdr));
+
+    /// readelf: Section '.bss' has no data to dump.
+    if (type != SHT_NOBITS) {
+      offset += size;
+    }
+  };
+
+  /// the contents. streamed .text is right behind the elf header already
+  for (uint32_t Id = 1; Id < Sections.size(); ++Id) {
+    const auto& Section = Sections[Id];
+    if (!Streaming || Id != MCSymbol::text) {
+      mkAlign(Section.MaxAlign);
+    }
+
+    SectionHeader(Section.Name, Section.Type, Section.Flags, Section.Size,
+                  Section.MaxAlign);
+  }
+
+  auto StrTabNdx = static_cast<uint32_t>(Elf_Shdrs.size());
+  SectionHeader(".strtab", SHT_STRTAB, 0, StrTab.size(), 1);
+
+  /// .symtab: link to .strtab
+  auto SymTabNdx = static_cast<uint32_t>(Elf_Shdrs.size());
+  mkAlign(8);
+  SectionHeader(".symtab", SHT_SYMTAB, 0,
+                this->Elf_Syms.size() * sizeof(Elf64_Sym), 8, StrTabNdx,
+                static_cast<uint32_t>(LocalSyms), sizeof(Elf64_Sym));
+
+  /// .rela.<name>: link to .symtab, info to the section they relocate
+  for (size_ty i = 0; i < RelaOf.size(); ++i) {
+    mkAlign(8);
+    SectionHeader(RelaNames[i], SHT_RELA, SHF_INFO_LINK,
+                  Sections[RelaOf[i]].Relas.size() * sizeof(Elf64_Rela), 8,
+                  SymTabNdx, RelaOf[i], sizeof(Elf64_Rela));
+  }
+
+  /// the .rela of each text section count as well, e_shnum and e_shstrndx
+  /// are 16 bits
+  if (Elf_Shdrs.size() + 1 >= SHN_LORESERVE) {
+    utils::fatal("too many sections with their .rela, ELF indexes at most "
+                 "65279 without SHN_XINDEX");
+  }
+  hdr.e_shstrndx = static_cast<uint16_t>(Elf_Shdrs.size());
+  SectionHeader(".shstrtab", SHT_STRTAB, 0, SHStrTab.size(), 1);
+
+  hdr.e_shnum = static_cast<uint16_t>(Elf_Shdrs.size());
+
+  mkAlign(8);
+  hdr.e_shoff = offset;
+}
+
+void MCContext::writein() {
+
+  if (Streaming) {
+    /// from here on .text is only what is left to patch
+    this->streamText();
+
+    Sections[MCSymbol::text].Insts = std::move(PendingInsts);
+    Fixups = std::move(PendingFixups);
+  } else {
+    if (FoldFunctions) {
+      this->foldText();
+    }
+    /// merges the functions back into .text, unless they keep sections
+    if (Ordering || (FoldFunctions && !FunctionSections)) {
+      this->orderText();
+    }
+    this->layoutText();
+  }
+
+  this->Relo();
+
+  this->mkSymTab();
+
+  this->Ehdr_Shdr();
+
+  /// every section is appended in place, the whole object goes out in a
+  /// single flush. the text sections are encoded here, they have to outlive
+  /// it
+  std::vector<std::unique_ptr<uint8_t[]>> Texts;
+
+  auto streamWriteIn = [&](const void* data, size_ty n) {
+    this->file.append(data, n);
+  };
+
+  /// elf header
+  if (!Streaming) {
+    streamWriteIn(&this->Elf_Ehdr, sizeof(Elf64_Ehdr));
+  }
+
+  for (size_ty Ndx = 1; Ndx < Elf_Shdrs.size(); ++Ndx) {
+    const auto& Shdr = Elf_Shdrs[Ndx];
+
+    if (Streaming && Ndx == MCSymbol::text) {
+      utils_assert(file.tell() == Shdr.sh_offset + Shdr.sh_size,
+                   "streamed text landed at the wrong offset");
+      continue;
+    }
+    /// SHT_NOBITS, takes no bytes in the file
+    if (Shdr.sh_type == SHT_NOBITS) {
+      continue;
+    }
+
+    this->file.padTo(Shdr.sh_offset);
+
+    if (Ndx < Sections.size()) {
+      const auto& Section = Sections[Ndx];
+
+      if (Section.Kind == MCSection::kText) {
+        auto& Text = Texts.emplace_back(
+            std::make_unique_for_overwrite<uint8_t[]>(Section.Size));
+        [[maybe_unused]] auto Size = encodeText(Section.Insts, Text.get());
+        utils_assert(Size == Section.Size, "text size mismatch");
+
+        streamWriteIn(Text.get(), Section.Size);
+      } else {
+        streamWriteIn(Section.Data.data(), Section.Data.size());
+      }
+    } else if (Shdr.sh_type == SHT_SYMTAB) {
+      streamWriteIn(Elf_Syms.data(), Shdr.sh_size);
+    } else if (Shdr.sh_type == SHT_RELA) {
+      streamWriteIn(Sections[Shdr.sh_info].Relas.data(), Shdr.sh_size);
+    } else if (Ndx == Elf_Ehdr.e_shstrndx) {
+      streamWriteIn(SHStrTab.data(), SHStrTab.size());
+    } else {
+      streamWriteIn(StrTab.data(), StrTab.size());
+    }
   }
 
   /// dump section headers
   {
-    padSection(*this->Offsets.find("section header table"));
+    this->file.padTo(Elf_Ehdr.e_shoff);
+    streamWriteIn(Elf_Shdrs.begin(), Elf_Shdrs.size() * sizeof(Elf64_Shdr));
+  }
 
-    for (auto& shdr : Elf_Shdrs) {
-      streamWriteIn((char*)&shdr, sizeof(Elf64_Shdr));
-    }
+  this->file.flush();
+
+  if (Streaming) {
+    this->patchText();
+    this->file.pwrite(&this->Elf_Ehdr, sizeof(Elf64_Ehdr), 0);
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,43 @@
+#include "mc/MCFragment.hpp"
+#include "utils/macro.hpp"
+#include <algorithm>
+
+using namespace mc;
+
+void MCFragmentList::add(const MCFragment& Frag) {
+  auto End = Frags.empty() ? 0 : Frags.back().Start + Frags.back().ParsedSize;
+  utils_assert(Frag.Start >= End, "fragments added out of order");
+
+  if (Frag.Start > End) {
+    Frags.push_back({MCFragment::kData, End, Frag.Start - End});
+  }
+  Frags.push_back(Frag);
+}
+
+void MCFragmentList::layoutFrom(std::size_t k) {
+  auto Offset = Frags[k].Offset;
+
+  for (; k < Frags.size(); ++k) {
+    auto& Frag = Frags[k];
+    Frag.Offset = Offset;
+
+    if (Frag.Kind == MCFragment::kAlign) {
+      Frag.Size = (Frag.Align - Offset % Frag.Align) % Frag.Align;
+      if (Frag.Size > Frag.MaxSkip) {
+        Frag.Size = 0;
+      }
+    }
+    Offset += Frag.Size;
+  }
+}
+
+std::size_t MCFragmentList::moved(std::size_t Start) const {
+  auto Iter = std::upper_bound(Frags.begin(), Frags.end(), Start,
+                               [](std::size_t Start, const MCFragment& Frag) {
+                                 return Start < Frag.Start;
+                               });
+  utils_assert(Iter != Frags.begin(), "offset in front of every fragment");
+
+  --Iter;
+  return Iter->Offset + (Start - Iter->Start);
+}
@@ -0,0 +1,27 @@
+#include "mc/MCInstStore.hpp"
+#include <cstdint>
+#include <vector>
+
+using namespace mc;
+
+void MCInstStore::append(MCInstStore& Other, size_ty TextBase) {
+  auto concat = [](auto& To, const auto& From) {
+    To.insert(To.end(), From.begin(), From.end());
+  };
+
+  auto Begin = size();
+
+  concat(OpCodes, Other.OpCodes);
+  concat(Regs, Other.Regs);
+  concat(NumRegs, Other.NumRegs);
+  concat(Kinds, Other.Kinds);
+  concat(Imms, Other.Imms);
+  concat(Offsets, Other.Offsets);
+  concat(Locs, Other.Locs);
+
+  for (auto i = Begin; i < size(); ++i) {
+    Offsets[i] += static_cast<uint32_t>(TextBase);
+  }
+
+  Other = MCInstStore();
+}
@@ -0,0 +1,92 @@
+#include "mc/MCOrdering.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <charconv>
+#include <utility>
+#include <vector>
+
+using namespace mc;
+
+namespace {
+
+/// the fields of every line that is neither empty nor a # comment
+template <typename Fn> void forEachLine(StringRef Text, Fn&& fn) {
+  std::string_view Rest(Text.data(), Text.size());
+
+  while (!Rest.empty()) {
+    auto End = std::min(Rest.find('\n'), Rest.size());
+    auto Line = Rest.substr(0, End);
+    Rest.remove_prefix(std::min(End + 1, Rest.size()));
+
+    constexpr std::string_view Blanks = " \t\r";
+    std::vector<std::string_view> Fields;
+    for (std::size_t i = Line.find_first_not_of(Blanks);
+         i != std::string_view::npos; i = Line.find_first_not_of(Blanks, i)) {
+      auto j = std::min(Line.find_first_of(Blanks, i), Line.size());
+      Fields.push_back(Line.substr(i, j - i));
+      i = j;
+    }
+
+    if (!Fields.empty() && Fields.front().front() != '#') {
+      fn(Fields);
+    }
+  }
+}
+
+} // namespace
+
+void MCOrdering::add(std::string_view Name, uint32_t Rank) {
+  if (Ranks.contains(Name)) {
+    return;
+  }
+  Ranks.emplace(Names.emplace_back(Name), Rank);
+}
+
+MCOrdering MCOrdering::fromSymbolFile(StringRef Text) {
+  MCOrdering Order;
+  uint32_t Rank = 0;
+
+  forEachLine(Text, [&](const std::vector<std::string_view>& Fields) {
+    if (Fields.size() != 1) {
+      utils::fatal("expecting one symbol per line");
+    }
+    Order.add(Fields.front(), Rank++);
+  });
+
+  return Order;
+}
+
+MCOrdering MCOrdering::fromProfile(StringRef Text) {
+  /// in the order first listed, which breaks the ties
+  std::vector<std::pair<std::string_view, uint64_t>> Samples;
+  std::unordered_map<std::string_view, std::size_t> Seen;
+
+  forEachLine(Text, [&](const std::vector<std::string_view>& Fields) {
+    uint64_t Count = 0;
+    auto Num = Fields.size() == 2 ? Fields[1] : std::string_view();
+    auto [ptr, ec] =
+        std::from_chars(Num.data(), Num.data() + Num.size(), Count);
+    if (Num.empty() || ec != std::errc{} || ptr != Num.data() + Num.size()) {
+      utils::fatal("expecting 'symbol count' per line");
+    }
+
+    auto [Iter, New] = Seen.emplace(Fields[0], Samples.size());
+    if (New) {
+      Samples.emplace_back(Fields[0], Count);
+    } else {
+      Samples[Iter->second].second += Count;
+    }
+  });
+
+  std::stable_sort(
+      Samples.begin(), Samples.end(),
+      [](const auto& L, const auto& R) { return L.second > R.second; });
+
+  MCOrdering Order;
+  uint32_t Rank = 0;
+  for (auto [Name, Count] : Samples) {
+    Order.add(Name, Count ? Rank++ : Cold);
+  }
+
+  return Order;
+}
@@ -0,0 +1,23 @@
+#include "mc/MCSection.hpp"
+#include "utils/ADT/StringSwitch.hpp"
+
+using namespace mc;
+template <typename T> using StringSwitch = utils::ADT::StringSwitch<T>;
+
+std::pair<uint32_t, uint64_t> MCSection::defaultsFor(StringRef Name) {
+  using Defaults = std::pair<uint32_t, uint64_t>;
+
+  constexpr uint64_t AW = SHF_ALLOC | SHF_WRITE;
+
+  return StringSwitch<Defaults>(Name)
+      .Case(".init_array", Defaults{SHT_INIT_ARRAY, AW})
+      .Case(".fini_array", Defaults{SHT_FINI_ARRAY, AW})
+      .Case(".preinit_array", Defaults{SHT_PREINIT_ARRAY, AW})
+      .BeginWith(".text", Defaults{SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR})
+      .BeginWith(".rodata", Defaults{SHT_PROGBITS, SHF_ALLOC})
+      .BeginWith(".data", Defaults{SHT_PROGBITS, AW})
+      .BeginWith(".sdata", Defaults{SHT_PROGBITS, AW})
+      .BeginWith(".bss", Defaults{SHT_NOBITS, AW})
+      .BeginWith(".sbss", Defaults{SHT_NOBITS, AW})
+      .Default(Defaults{SHT_PROGBITS, 0});
+}
@@ -0,0 +1,28 @@
+#include "mc/MCSymbol.hpp"
+
+using namespace mc;
+
+uint32_t MCSymbolTable::intern(StringRef Name) {
+  std::string_view Key(Name.data(), Name.size());
+
+  if (auto Iter = Index.find(Key); Iter != Index.end()) {
+    return Iter->second;
+  }
+
+  auto Id = static_cast<uint32_t>(Symbols.size());
+  auto& Sym = Symbols.emplace_back();
+  Sym.Name = Key;
+  Index.emplace(Sym.Name, Id);
+
+  return Id;
+}
+
+MCSymbol* MCSymbolTable::find(StringRef Name) {
+  auto Iter = Index.find(std::string_view(Name.data(), Name.size()));
+  return Iter == Index.end() ? nullptr : &Symbols[Iter->second];
+}
+
+const MCSymbol* MCSymbolTable::find(StringRef Name) const {
+  auto Iter = Index.find(std::string_view(Name.data(), Name.size()));
+  return Iter == Index.end() ? nullptr : &Symbols[Iter->second];
+}
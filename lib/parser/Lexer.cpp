@@ -1,6 +1,7 @@
 #include "parser/Lexer.hpp"
 #include "mc/MCOpCode.hpp"
 #include "mc/MCOperand.hpp"
+#include "parser/LexerScan.hpp"
 #include "utils/likehood.hpp"
 #include <algorithm>
 #include <cctype>
@@ -54,18 +55,21 @@ std::string to_string(TokenType type) {
 
 using namespace parser;
 
-void Token::print() const {
+void Token::print(const Lexer& lexer) const {
+  auto loc = lexer.getLocation(offset);
   std::cout << "Token(" << to_string(type) << ", lexeme: '" << lexeme << "', "
             << "line: " << loc.line << ", col: " << loc.col << ")\n";
 }
 
 Lexer::Lexer(StringRef source) : m_source(source) {}
 
+Lexer::Lexer(StringRef source, std::size_t begin, std::size_t end)
+    : m_source(source.slice(0, end)), m_cursor(begin) {}
+
 bool Lexer::isAtEnd() const { return m_cursor >= m_source.size(); }
 
 char Lexer::advance() {
   if (!isAtEnd()) {
-    m_col++;
     return m_source[m_cursor++];
   }
   return '\0';
@@ -83,45 +87,58 @@ char Lexer::peekNext() const {
   return m_source[m_cursor + 1];
 }
 
+void Lexer::skipTo(const char* pos) { m_cursor = pos - m_source.begin(); }
+
 void Lexer::skipWhitespaceAndComments() {
-  while (!isAtEnd()) {
-    char c = peek();
-    switch (c) {
-    case ' ':
-    case '\r':
-    case '\t':
-      advance();
-      break;
-    case '#': // Comment goes to the end of the line
-      while (peek() != '\n' && !isAtEnd()) {
-        advance();
-      }
+  const char* cur = m_source.begin() + m_cursor;
+  const char* end = m_source.end();
+
+  for (;;) {
+    cur = scan::skipBlanks(cur, end);
+    if (cur == end || *cur != '#') {
       break;
-    default:
-      return;
     }
+    // Comment goes to the end of the line
+    cur = scan::findNewline(cur, end);
+  }
+
+  skipTo(cur);
+}
+
+mc::Location Lexer::getLocation(utils::SourceOffset offset) const {
+  if (!m_indexed) {
+    const char* cur = m_source.begin();
+    const char* end = m_source.end();
+
+    while ((cur = scan::findNewline(cur, end)) != end) {
+      m_newlines.push_back(cur - m_source.begin());
+      ++cur;
+    }
+    m_indexed = true;
   }
+
+  // newlines before offset, a '\n' belongs to the line it terminates
+  auto line = std::lower_bound(m_newlines.begin(), m_newlines.end(), offset) -
+              m_newlines.begin();
+  auto lineStart = line ? m_newlines[line - 1] + 1 : 0;
+
+  return {static_cast<std::size_t>(line) + 1, offset - lineStart + 1};
 }
 
 Token Lexer::makeToken(TokenType type) const {
   // For single-character tokens
-  return {type, m_source.slice(m_cursor - 1, 1).str(), {m_line, m_col - 1}};
+  return {type, m_source.slice(m_cursor - 1, m_cursor), m_cursor - 1};
 }
 
-Token Lexer::makeToken(TokenType type, StringRef lexeme) const {
-  return {type, lexeme.str(), {m_line, m_col - lexeme.size()}};
+Token Lexer::makeToken(TokenType type, StringRef lexeme, uint16_t id) const {
+  return {type, lexeme, m_cursor - lexeme.size(), id};
 }
 
 Token Lexer::scanIdentifier() {
   size_t start = m_cursor - 1;
-  while (isalnum(peek()) || peek() == '_' || peek() == '.') {
-    advance();
-  }
+  skipTo(scan::skipIdentifier(m_source.begin() + m_cursor, m_source.end()));
 
-  std::string lexeme = m_source.slice(start, m_cursor).str();
-
-  std::transform(lexeme.begin(), lexeme.end(), lexeme.begin(),
-                 [](unsigned char c) { return std::tolower(c); });
+  StringRef lexeme = m_source.slice(start, m_cursor);
 
   // Check if it's a label definition
   if (peek() == ':') {
@@ -130,11 +147,12 @@ Token Lexer::scanIdentifier() {
                      m_source.slice(start, m_cursor));
   }
 
-  if (MnemonicContain(lexeme.c_str())) {
-    return makeToken(TokenType::INSTRUCTION, lexeme);
+  // mnemonics and registers are case-insensitive, symbols keep their case
+  if (auto op = MnemonicMap.position(lexeme)) {
+    return makeToken(TokenType::INSTRUCTION, lexeme, *op);
   }
-  if (mc::Registers.find(lexeme)) {
-    return makeToken(TokenType::REGISTER, lexeme);
+  if (auto reg = mc::Registers.position(lexeme)) {
+    return makeToken(TokenType::REGISTER, lexeme, *reg);
   }
 
   return makeToken(TokenType::IDENTIFIER, lexeme);
@@ -145,29 +163,29 @@ Token Lexer::scanNumber() {
   // Check for hexadecimal
   if (m_source[start] == '0' && (peek() == 'x' || peek() == 'X')) {
     advance(); // consume 'x'
-    while (isxdigit(peek())) {
-      advance();
-    }
+    skipTo(scan::skipHexDigits(m_source.begin() + m_cursor, m_source.end()));
     return makeToken(TokenType::HEX_INTEGER, m_source.slice(start, m_cursor));
   }
 
   // Handle negative numbers at the start
   if (m_source[start] == '-') {
     if (!isdigit(peek())) {
-      return makeToken(TokenType::UNKNOWN, m_source.slice(start, 1));
+      return makeToken(TokenType::UNKNOWN, m_source.slice(start, start + 1));
     }
   }
 
-  // Decimal
+  // Decimal, a '.' is only taken right after a digit
   bool dot = false;
-  while (isdigit(peek())) {
+  for (;;) {
+    auto digits = m_cursor;
+    skipTo(scan::skipDigits(m_source.begin() + m_cursor, m_source.end()));
 
-    advance();
-
-    if (utils::is_unlikely(peek() == '.')) {
-      dot = true;
-      advance(); // skip '.'
+    if (m_cursor == digits || utils::is_likely(peek() != '.')) {
+      break;
     }
+
+    dot = true;
+    advance(); // skip '.'
   }
 
   return makeToken(dot ? TokenType::FLOAT : TokenType::INTEGER,
@@ -177,10 +195,6 @@ Token Lexer::scanNumber() {
 Token Lexer::scanString() {
   size_t start = m_cursor; // Start after the opening quote
   while (peek() != '"' && !isAtEnd()) {
-    if (peek() == '\n') { // Unterminated string
-      m_line++;
-      m_col = 1;
-    }
     advance();
   }
 
@@ -197,7 +211,7 @@ Token Lexer::nextToken() {
   skipWhitespaceAndComments();
 
   if (isAtEnd()) {
-    return {TokenType::END_OF_FILE, "", {m_line, m_col}};
+    return {TokenType::END_OF_FILE, "", m_cursor};
   }
 
   char c = advance();
@@ -213,9 +227,7 @@ Token Lexer::nextToken() {
   if (isalpha(c) || c == '_' || c == '.') {
     if (c == '.') { // assume to be a directive
       size_t start = m_cursor - 1;
-      while (isalnum(peek()) || peek() == '_') {
-        advance();
-      }
+      skipTo(scan::skipDirective(m_source.begin() + m_cursor, m_source.end()));
       return makeToken(TokenType::DIRECTIVE, m_source.slice(start, m_cursor));
     }
     return scanIdentifier();
@@ -226,12 +238,8 @@ Token Lexer::nextToken() {
   }
 
   switch (c) {
-  case '\n': {
-    Token token = makeToken(TokenType::NEWLINE);
-    m_line++;
-    m_col = 1;
-    return token;
-  }
+  case '\n':
+    return makeToken(TokenType::NEWLINE);
   case ',':
     return makeToken(TokenType::COMMA);
   case '(':
@@ -247,5 +255,5 @@ Token Lexer::nextToken() {
     return makeToken(TokenType::EXPR_OPERATOR);
   }
 
-  return makeToken(TokenType::UNKNOWN, m_source.slice(m_cursor - 1, 1));
+  return makeToken(TokenType::UNKNOWN, m_source.slice(m_cursor - 1, m_cursor));
 }
\ No newline at end of file
@@ -1,19 +1,25 @@
 #include "parser/Parser.hpp"
 #include "mc/MCContext.hpp"
 #include "mc/MCExpr.hpp"
-#include "mc/MCInst.hpp"
 #include "mc/MCOperand.hpp"
 #include "parser/Lexer.hpp"
+#include "parser/LexerScan.hpp"
 #include "utils/ADT/SmallVector.hpp"
 #include "utils/ADT/StringSwitch.hpp"
+#include "utils/ThreadPool.hpp"
 #include "utils/logger.hpp"
 #include "utils/macro.hpp"
 #include "utils/misc.hpp"
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
-#include <string>
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <system_error>
 #include <tuple>
+#include <vector>
 
 using namespace parser;
 using namespace mc;
@@ -21,28 +27,197 @@ template <typename T> using StringSwitch = utils::ADT::StringSwitch<T>;
 template <typename T, std::size_t N>
 using SmallVector = utils::ADT::SmallVector<T, N>;
 
+namespace {
+int64_t parseInteger(StringRef Str, int Base = 10) {
+  int64_t Value = 0;
+  auto [ptr, ec] = std::from_chars(Str.begin(), Str.end(), Value, Base);
+
+  if (ec == std::errc::result_out_of_range) {
+    utils::fatal("integer literal out of range");
+  }
+  if (ec != std::errc{} || ptr != Str.end()) {
+    utils::fatal("malformed integer literal");
+  }
+
+  return Value;
+}
+} // namespace
+
 void Parser::parse() {
 
   auto token = this->lexer.nextToken();
-  MCInst* curInst = nullptr;
-  SmallVector<std::string, 4> DirectiveStack;
-  MCContext::size_ty curOffset = 0;
+  const MCOpCode* curInst = nullptr; // the inst open in ctx, if any
+  SmallVector<StringRef, 4> DirectiveStack; // slices of the source
+
+  if (!EntrySection.empty()) {
+    DirectiveStack.push_back(EntrySection);
+  }
+
+  /// every read of the current section goes through here, so that a chunk
+  /// parsed under an assumed EntrySection knows if the guess mattered
+  auto section = [&]() {
+    if (ExitSection.empty()) {
+      EntryUsed = true;
+    }
+    return ctx.getSectionKind();
+  };
 
   auto advance = [&]() { token = this->lexer.nextToken(); };
 
-  auto RegHelper = [&](const StringRef& reg) -> uint8_t {
+  /// .section Name, "flags", @type from the name on, the flags and the type
+  /// are optional. switches ctx to it and returns the name, a slice of the
+  /// source: .text.hot is lexed as two directives, adjacent tokens are one
+  auto sectionOperands = [&]() -> StringRef {
+    utils_assert(token.type == TokenType::DIRECTIVE ||
+                     token.type == TokenType::IDENTIFIER,
+                 "expecting a section name");
+
+    auto joins = [](TokenType Type) {
+      return Type == TokenType::DIRECTIVE || Type == TokenType::IDENTIFIER ||
+             Type == TokenType::INSTRUCTION || Type == TokenType::REGISTER ||
+             Type == TokenType::INTEGER || Type == TokenType::FLOAT;
+    };
+
+    auto Begin = token.lexeme.begin();
+    auto End = token.lexeme.end();
+    for (advance(); token.lexeme.begin() == End && joins(token.type);
+         advance()) {
+      End = token.lexeme.end();
+    }
+    StringRef Name(Begin, static_cast<std::size_t>(End - Begin));
+
+    auto [Type, Flags] = MCSection::defaultsFor(Name);
+
+    if (token.type == TokenType::COMMA) {
+      advance();
+      utils_assert(token.type == TokenType::STRING_LITERAL,
+                   "expecting section flags");
+
+      Flags = 0;
+      for (auto c : token.lexeme) {
+        switch (c) {
+        case 'a':
+          Flags |= SHF_ALLOC;
+          break;
+        case 'w':
+          Flags |= SHF_WRITE;
+          break;
+        case 'x':
+          Flags |= SHF_EXECINSTR;
+          break;
+        default:
+          utils::fatal("unsupported section flag");
+        }
+      }
+      advance();
+    }
+
+    if (token.type == TokenType::COMMA) {
+      advance();
+      utils_assert(token.type == TokenType::UNKNOWN && token.lexeme == "@",
+                   "expecting @type");
+      advance();
+
+      Type = StringSwitch<uint32_t>(token.lexeme)
+                 .Case("progbits", static_cast<uint32_t>(SHT_PROGBITS))
+                 .Case("nobits", static_cast<uint32_t>(SHT_NOBITS))
+                 .Case("note", static_cast<uint32_t>(SHT_NOTE))
+                 .Case("init_array", static_cast<uint32_t>(SHT_INIT_ARRAY))
+                 .Case("fini_array", static_cast<uint32_t>(SHT_FINI_ARRAY))
+                 .Case("preinit_array",
+                       static_cast<uint32_t>(SHT_PREINIT_ARRAY))
+                 .Error();
+      advance();
+    }
+
+    ctx.switchSection(Name, Type, Flags);
+    return Name;
+  };
+
+  /// .align / .balign / .p2align Align, Fill, MaxSkip from Align on, the
+  /// fill and the max-skip are optional. pads the current section, false if
+  /// a chunk abandons its guess of it
+  auto alignOperands = [&](StringRef Directive, SourceOffset Loc) -> bool {
+    if (token.type != TokenType::INTEGER) {
+      utils::fatal("expecting an alignment");
+    }
+    auto dw = parseInteger(token.lexeme);
+    advance();
+
+    std::optional<int64_t> Fill;
+    auto MaxSkip = MCContext::NoMaxSkip;
+    if (token.type == TokenType::COMMA) {
+      advance();
+      if (token.type == TokenType::INTEGER) {
+        Fill = parseInteger(token.lexeme);
+        advance();
+      } else if (token.type == TokenType::HEX_INTEGER) {
+        Fill = parseInteger(token.lexeme.slice(2), 16);
+        advance();
+      }
+
+      if (token.type == TokenType::COMMA) {
+        advance();
+        if (token.type != TokenType::INTEGER) {
+          utils::fatal("expecting a max-skip");
+        }
+        MaxSkip = static_cast<std::size_t>(parseInteger(token.lexeme));
+        advance();
+      }
+    }
+
+    auto cur = section();
+
+    if (dw < 0) {
+      utils::fatal("expecting a non-negative alignment");
+    }
+
+    std::size_t Align = 0;
+    if (Directive == ".balign") {
+      if (!utils::log2(dw)) {
+        utils::fatal("expecting a power of two after .balign");
+      }
+      Align = dw;
+    } else {
+      if (dw >= 16) {
+        utils::fatal("expecting a .p2align/.align exponent below 16");
+      }
+      /// .align takes the power of two as .p2align does, as GAS does for
+      /// RISC-V
+      Align = std::size_t(1) << dw;
+    }
+
+    if (cur == MCSection::kData) {
+      ctx.makeDataBufAlign(Align, static_cast<uint8_t>(Fill.value_or(0)),
+                           MaxSkip);
+    } else if (cur == MCSection::kNoBits) {
+      if (Fill.value_or(0) != 0) {
+        utils::fatal("data def in bss supposed to be all zero");
+      }
+      ctx.makeBssBufAlign(Align, MaxSkip);
+    } else {
+      if (Fill) {
+        /// data in what a chunk took for .text
+        if (Speculative && ExitSection.empty()) {
+          return false;
+        }
+        utils::fatal("text is padded with nops, not a fill");
+      }
+      ctx.alignText(Align, Loc, MaxSkip);
+    }
+    return true;
+  };
+
+  /// the full number for every inst, the rd'/rs1'/rs2' fields of the
+  /// compressed formats keep its low 3 bits
+  auto RegHelper = [&](const Token& reg) -> uint8_t {
     utils_assert(curInst, "expect curInst to be valid");
-    auto find_reg =
-        curInst->isCompressed() ? CRegisters.find(reg) : Registers.find(reg);
-    utils_assert(find_reg, "invalid register literal");
-    return *find_reg;
+    return Registers.values()[reg.id];
   };
 
   auto JmpBrHelper = [&](const StringRef& label) {
-    ctx.addReloInst(curInst, label.str());
-
-    /// 12 bits offset padding
-    curInst->addOperand(MCOperand::makeImm(0));
+    /// offset padding until the label is resolved
+    ctx.addTextFixup(label);
   };
 
   while (token.type != TokenType::END_OF_FILE) {
@@ -52,7 +227,7 @@ void Parser::parse() {
     case TokenType::NEWLINE:
       /// Inst commit
       if (curInst) {
-        curOffset = ctx.commitTextInst();
+        ctx.commitTextInst();
         curInst = nullptr;
       }
       advance();
@@ -66,13 +241,13 @@ void Parser::parse() {
       advance();
       utils_assert(token.type == TokenType::REGISTER,
                    "parse as an expr failed");
-      curInst->addOperand(MCOperand::makeReg(RegHelper(token.lexeme)));
+      ctx.addTextBaseReg(RegHelper(token));
       advance();
       utils_assert(token.type == TokenType::RPAREN, "expecting right paren");
       advance();
       break;
     case TokenType::RPAREN:
-      utils::unreachable("encounter dangling right paren");
+      utils::fatal("encounter dangling right paren");
     case TokenType::COLON:
       advance();
       break;
@@ -83,28 +258,70 @@ void Parser::parse() {
       /// TODO: pseudo instructions
       if (curInst) {
         JmpBrHelper(token.lexeme);
-      } else {
-        using Ndx = MCContext::NdxSection;
+      } else if (!DirectiveStack.empty() &&
+                 DirectiveStack.back() == ".option") {
+        auto Balanced = StringSwitch<bool>(token.lexeme)
+                            .Case("rvc",
+                                  [&](auto&& _) {
+                                    ctx.setRVC(true);
+                                    return true;
+                                  })
+                            .Case("norvc",
+                                  [&](auto&& _) {
+                                    ctx.setRVC(false);
+                                    return true;
+                                  })
+                            .Case("relax",
+                                  [&](auto&& _) {
+                                    ctx.setRelax(true);
+                                    return true;
+                                  })
+                            .Case("norelax",
+                                  [&](auto&& _) {
+                                    ctx.setRelax(false);
+                                    return true;
+                                  })
+                            .Case("push",
+                                  [&](auto&& _) {
+                                    ctx.pushOptions();
+                                    return true;
+                                  })
+                            .Case("pop",
+                                  [&](auto&& _) { return ctx.popOptions(); })
+                            .Error();
+
+        if (!Balanced) {
+          /// the push is in an earlier chunk
+          if (Speculative) {
+            Abandoned = true;
+            return;
+          }
+          utils::fatal(".option pop without .option push");
+        }
 
+        DirectiveStack.pop_back(); // .option
+      } else if ((token.lexeme == "call" || token.lexeme == "tail") &&
+                 !DirectiveStack.empty() && section() == MCSection::kText) {
+        auto Loc = token.offset;
+        auto Tail = token.lexeme == "tail";
+        advance();
+
+        utils_assert(token.type == TokenType::IDENTIFIER,
+                     "expecting a symbol to call");
+        ctx.addCall(token.lexeme, Tail, Loc);
+      } else {
         auto isExist =
             !StringSwitch<bool>(DirectiveStack.back())
                  .Case(".global", ".globl",
                        [&](auto&& _) {
-                         const auto& section =
-                             DirectiveStack[DirectiveStack.size() - 2];
+                         auto cur = section();
 
-                         if (section == ".data") {
+                         if (cur == MCSection::kData) {
                            ctx.addDataVar(token.lexeme);
-                           return ctx.addReloSym(token.lexeme, Ndx::data);
-                         } else if (section == ".bss") {
+                         } else if (cur == MCSection::kNoBits) {
                            ctx.addBssVar(token.lexeme);
-                           return ctx.addReloSym(token.lexeme, Ndx::bss);
-                         } else if (section == ".text") {
-                           return ctx.addReloSym(token.lexeme, Ndx::text);
                          }
-
-                         utils::unreachable(
-                             "cant match the section of this label");
+                         return ctx.addReloSym(token.lexeme);
                        })
                  .Error();
 
@@ -115,13 +332,15 @@ void Parser::parse() {
       advance();
       break;
     case TokenType::INTEGER: {
-      auto dw = std::stoll(token.lexeme);
+      auto dw = parseInteger(token.lexeme);
       if (curInst) {
-        curInst->addOperand(MCOperand::makeImm(dw));
+        ctx.addTextImm(dw);
       } else {
         /// TODO: more directive
 
-        if (DirectiveStack[DirectiveStack.size() - 2] == ".data") {
+        auto cur = section();
+
+        if (cur == MCSection::kData) {
           StringSwitch<bool>(DirectiveStack.back())
               .Case(".half",
                     [&](auto&& _) {
@@ -138,28 +357,11 @@ void Parser::parse() {
                       ctx.pushDataBuf<uint64_t>(dw);
                       return true;
                     })
-              .Case(".align",
-                    [&](auto&& _) {
-                      utils_assert(dw < 16, "expectling align target to be "
-                                            "small than 16");
-
-                      ctx.makeDataBufAlign(utils::pow2i(dw));
-
-                      return true;
-                    })
-              .Case(".balign",
-                    [&](auto&& _) {
-                      auto e = utils::log2(dw);
-                      utils_assert(e, "expecting dw to be pow of 2");
-
-                      ctx.makeDataBufAlign(dw);
-                      return true;
-                    })
               .Error();
 
           DirectiveStack.pop_back();
 
-        } else if (DirectiveStack[DirectiveStack.size() - 2] == ".bss") {
+        } else if (cur == MCSection::kNoBits) {
           utils_assert(dw == 0, "data def in bss supposed to be all zero");
 
           StringSwitch<bool>(DirectiveStack.back())
@@ -168,37 +370,25 @@ void Parser::parse() {
                       ctx.pushBssBuf(dw);
                       return true;
                     })
-              .Case(".align",
-                    [&](auto&& _) {
-                      utils_assert(dw < 16, "expectling align target to be "
-                                            "small than 16");
-
-                      ctx.makeBssBufAlign(utils::pow2i(dw));
-
-                      return true;
-                    })
-              .Case(".balign",
-                    [&](auto&& _) {
-                      auto e = utils::log2(dw);
-                      utils_assert(e, "expecting dw to be pow of 2");
-
-                      ctx.makeBssBufAlign(dw);
-                      return true;
-                    })
               .Error();
 
           DirectiveStack.pop_back();
 
         } else {
-          utils::unreachable("expect literal in .data or .bss section");
+          /// data in what a chunk took for .text
+          if (Speculative && ExitSection.empty()) {
+            Abandoned = true;
+            return;
+          }
+          utils::fatal("expect literal in a data or bss section");
         }
       }
     }
       advance();
       break;
     case TokenType::HEX_INTEGER:
-      curInst->addOperand(
-          MCOperand::makeImm(std::stoll(token.lexeme, nullptr, 16)));
+      utils_assert(curInst, "expect curInst to be valid");
+      ctx.addTextImm(parseInteger(token.lexeme.slice(2), 16));
       advance();
       break;
     case TokenType::FLOAT:
@@ -213,8 +403,10 @@ void Parser::parse() {
                         auto [ptr, ec] = std::from_chars(
                             Str.data(), Str.data() + Str.size(), value);
 
-                        utils_assert(ec == std::error_code{},
-                                     "parse float point failed");
+                        if (ec != std::errc{} ||
+                            ptr != Str.data() + Str.size()) {
+                          utils::fatal("malformed floating point literal");
+                        }
 
                         return std::make_tuple(
                             *reinterpret_cast<uint64_t*>(&value), false);
@@ -225,8 +417,10 @@ void Parser::parse() {
                         auto [ptr, ec] = std::from_chars(
                             Str.data(), Str.data() + Str.size(), value);
 
-                        utils_assert(ec == std::error_code{},
-                                     "parse float point failed");
+                        if (ec != std::errc{} ||
+                            ptr != Str.data() + Str.size()) {
+                          utils::fatal("malformed floating point literal");
+                        }
 
                         return std::make_tuple(
                             *reinterpret_cast<uint64_t*>(&value), false);
@@ -267,7 +461,7 @@ void Parser::parse() {
         utils_assert(token.type == TokenType::INTEGER,
                      "expecting integer append");
 
-        op *= std::stoll(token.lexeme); // no hex
+        op *= parseInteger(token.lexeme); // no hex
 
         Append = *reinterpret_cast<uint64_t*>(&op);
 
@@ -277,41 +471,60 @@ void Parser::parse() {
       utils_assert(token.type == TokenType::RPAREN,
                    "expecting right paren after a modifier");
 
-      curInst->addOperand(
-          MCOperand::makeExpr(ctx.getTextExpr(Symbol, ty, Append)));
-
-      ctx.addReloInst(&(*curInst), Symbol);
+      ctx.addTextFixup(Symbol, ty, Append);
     }
       advance();
       break;
     case TokenType::INSTRUCTION: {
       /// must empty
 
-      curInst = ctx.newTextInst(token.lexeme);
-      curInst->modifyOffset(curOffset);
-      curInst->modifyLoc(token.loc);
-
-      auto [instAlign, padInst] =
-          (*curInst).isCompressed()
-              ? std::make_tuple(2, MCInst::makeNop(token.loc, curOffset))
-              : std::make_tuple(4, MCInst::makeNop(token.loc, curOffset));
-
-      /// make align
-      if (curOffset % instAlign) {
-        curInst->modifyOffset(ctx.addTextInst(std::move(padInst)));
-
-        curOffset = curInst->getOffset();
+      if (section() != MCSection::kText) {
+        /// code in what a chunk took for data
+        if (Speculative && ExitSection.empty()) {
+          Abandoned = true;
+          return;
+        }
+        utils::fatal("expecting insts in a text section");
       }
+
+      curInst = MnemonicOpCodes[token.id];
+      ctx.newTextInst(curInst, token.offset);
     }
       advance();
       break;
     case TokenType::REGISTER:
       utils_assert(curInst, "expect curInst to be valid");
-      curInst->addOperand(MCOperand::makeReg(RegHelper(token.lexeme)));
+      ctx.addTextReg(RegHelper(token));
       advance();
       break;
     case TokenType::DIRECTIVE:
-      /// TODO: .section
+      if (token.lexeme == ".section") {
+        /// leaves token behind its operands
+        advance();
+        auto Name = sectionOperands();
+
+        if (!DirectiveStack.empty()) {
+          DirectiveStack.pop_back();
+        }
+        ExitSection = StringRef(Name);
+        DirectiveStack.push_back(Name);
+        break;
+      }
+
+      if (StringSwitch<bool>(token.lexeme)
+              .Case(".align", ".balign", ".p2align", true)
+              .Default(false)) {
+        /// leaves token behind its operands
+        auto Directive = token.lexeme;
+        auto Loc = token.offset;
+        advance();
+        if (!alignOperands(Directive, Loc)) {
+          Abandoned = true;
+          return;
+        }
+        break;
+      }
+
       {
         auto isSectionDirective = StringSwitch<bool>(token.lexeme)
                                       .Case(".data", ".bss", ".text", true)
@@ -322,6 +535,11 @@ void Parser::parse() {
           DirectiveStack.pop_back();
         }
 
+        if (isSectionDirective) {
+          ExitSection = StringRef(token.lexeme);
+          ctx.switchSection(token.lexeme);
+        }
+
         DirectiveStack.push_back(token.lexeme);
       }
       advance();
@@ -329,11 +547,14 @@ void Parser::parse() {
     case TokenType::LABEL_DEFINITION:
       /// EG: main:
 
-      utils_assert(DirectiveStack.back() == ".text",
-                   "expecting ddefine label in .text section");
-      utils_assert(
-          ctx.addTextLabel(token.lexeme.substr(0, token.lexeme.length() - 1)),
-          "text label redefinition!");
+      {
+        /// kept out of the asserts, which vanish under NDEBUG
+        section();
+        [[maybe_unused]] auto isNew =
+            ctx.addLabel(token.lexeme.slice(0, token.lexeme.size() - 1));
+
+        utils_assert(isNew, "label redefinition!");
+      }
 
       advance();
       break;
@@ -341,7 +562,7 @@ void Parser::parse() {
       utils::todo("sting def pesudo not impl yet");
       break;
     default:
-      utils::unreachable("unkwnow type of current token");
+      utils::fatal("unkwnow type of current token");
     }
   }
 
@@ -351,15 +572,143 @@ void Parser::parse() {
 }
 
 const mc::MCOpCode* Parser::findOpCode(StringRef mnemonic) {
-  auto lookup = CacheLookUpTab.find(mnemonic);
+  auto op = MnemonicFind(mnemonic);
+  utils_assert(op, "invalid mnemonic");
+  return op;
+}
+namespace {
+/// chunk bounds of roughly equal size: Bounds.front() = 0, Bounds.back() =
+/// size, and every inner bound sits just past a '\n' that is neither inside
+/// a string literal nor the end of a comment opened inside one
+std::vector<std::size_t> splitSource(StringRef Source, std::size_t Chunks) {
+  const char* Begin = Source.begin();
+  const char* End = Source.end();
+
+  /// [open, close] quotes of every string literal, empty in the usual case
+  std::vector<std::pair<std::size_t, std::size_t>> Strings;
+  if (std::memchr(Begin, '"', Source.size())) {
+    for (const char* Cur = Begin; Cur != End; ++Cur) {
+      if (*Cur == '#') {
+        Cur = scan::findNewline(Cur, End);
+        if (Cur == End) {
+          break;
+        }
+      } else if (*Cur == '"') {
+        auto Open = Cur - Begin;
+        auto* Close = static_cast<const char*>(
+            std::memchr(Cur + 1, '"', End - Cur - 1));
+        Cur = Close ? Close : End - 1;
+        Strings.emplace_back(Open, Cur - Begin);
+      }
+    }
+  }
+
+  auto inString = [&](std::size_t Pos) {
+    auto It = std::upper_bound(
+        Strings.begin(), Strings.end(), Pos,
+        [](std::size_t P, const auto& Span) { return P < Span.first; });
+    return It != Strings.begin() && Pos <= std::prev(It)->second;
+  };
+
+  std::vector<std::size_t> Bounds{0};
+  auto Step = Source.size() / Chunks;
+
+  for (std::size_t i = 1; i < Chunks; ++i) {
+    auto Target = std::max(i * Step, Bounds.back());
+
+    const char* Cur = Begin + Target;
+    while ((Cur = scan::findNewline(Cur, End)) != End &&
+           inString(Cur - Begin)) {
+      ++Cur;
+    }
+    if (Cur == End) {
+      break;
+    }
 
-  if (lookup != nullptr) {
-    utils_assert(*lookup, "CacheLookUpTab contains invalid key");
-    return *lookup;
+    auto Bound = static_cast<std::size_t>(Cur - Begin) + 1;
+    if (Bound < Source.size() && Bound > Bounds.back()) {
+      Bounds.push_back(Bound);
+    }
   }
 
-  mc::MCOpCode const* op = MnemonicFind(mnemonic.c_str());
-  CacheLookUpTab.insert(mnemonic, op);
+  Bounds.push_back(Source.size());
+  return Bounds;
+}
+} // namespace
+
+parser::ParallelStats parser::parseParallel(MCContext& ctx, StringRef Source,
+                                            utils::ThreadPool& Pool,
+                                            std::size_t MinChunkSize) {
+  auto Chunks = std::min<std::size_t>(Pool.size() * 4,
+                                      Source.size() / std::max<std::size_t>(
+                                                          MinChunkSize, 1));
+  auto Bounds = splitSource(Source, std::max<std::size_t>(Chunks, 1));
+
+  if (Bounds.size() <= 2) {
+    Lexer lexer(Source);
+    Parser(ctx, lexer).parse();
+    return {1, 0};
+  }
 
-  return op;
-}
\ No newline at end of file
+  struct Chunk {
+    std::size_t Begin, End;
+    std::unique_ptr<MCContext> Ctx;
+    StringRef ExitSection;
+    bool EntryUsed = false;
+    bool Abandoned = false;
+  };
+
+  std::vector<Chunk> Parts(Bounds.size() - 1);
+
+  for (std::size_t i = 0; i < Parts.size(); ++i) {
+    Parts[i].Begin = Bounds[i];
+    Parts[i].End = Bounds[i + 1];
+    Parts[i].Ctx = ctx.makeChunk();
+
+    Pool.submit([&Part = Parts[i], Source, First = i == 0] {
+      /// compiler output mostly lives in .text, the first chunk knows
+      Lexer lexer(Source, Part.Begin, Part.End);
+      Parser parser(*Part.Ctx, lexer, First ? StringRef() : StringRef(".text"),
+                    !First);
+
+      parser.parse();
+
+      Part.ExitSection = parser.getExitSection();
+      Part.EntryUsed = parser.usedEntrySection();
+      Part.Abandoned = parser.abandoned();
+    });
+  }
+
+  Pool.wait();
+
+  /// stitch in order: a chunk is appended when its guesses hold at the
+  /// current section and section ends, otherwise it is parsed again in place
+  ParallelStats Stats{Parts.size(), 0};
+  StringRef Section;
+  for (std::size_t i = 0; i < Parts.size(); ++i) {
+    auto& Part = Parts[i];
+
+    bool Valid = !Part.Abandoned &&
+                 (i == 0 || !Part.EntryUsed || Section == ".text");
+
+    if (Valid && ctx.canAppend(*Part.Ctx)) {
+      ctx.append(*Part.Ctx);
+    } else {
+      Lexer lexer(Source, Part.Begin, Part.End);
+      Parser parser(ctx, lexer, Section);
+
+      parser.parse();
+
+      Part.ExitSection = parser.getExitSection();
+      ++Stats.Reparsed;
+    }
+
+    if (!Part.ExitSection.empty()) {
+      Section = StringRef(Part.ExitSection);
+    }
+
+    Part.Ctx.reset();
+  }
+
+  return Stats;
+}
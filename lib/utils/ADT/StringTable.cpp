@@ -0,0 +1,68 @@
+#include "utils/ADT/StringTable.hpp"
+#include "utils/logger.hpp"
+#include "utils/macro.hpp"
+#include <algorithm>
+
+using namespace utils::ADT;
+
+void StringTableBuilder::add(StringRef Str) {
+  utils_assert(!Finalized, "string table is already laid out");
+
+  std::string_view Key(Str.data(), Str.size());
+  if (Offsets.find(Key) != Offsets.end()) {
+    return;
+  }
+
+  /// a deque never moves its elements, the view stays valid
+  const auto& Owned = Strings.emplace_back(Key);
+  Offsets.emplace(Owned, 0);
+}
+
+void StringTableBuilder::finalize() {
+  utils_assert(!Finalized, "string table is already laid out");
+  Finalized = true;
+
+  Buffer.push_back('\x00');
+
+  std::vector<std::string_view> Order(Strings.begin(), Strings.end());
+
+  if (TailMerge) {
+    /// descending on the reversed strings: every string that ends with S
+    /// sorts right in front of S, the last one laid out is one of them
+    std::sort(Order.begin(), Order.end(),
+              [](std::string_view A, std::string_view B) {
+                return std::lexicographical_compare(B.rbegin(), B.rend(),
+                                                    A.rbegin(), A.rend());
+              });
+  }
+
+  std::string_view Prev;
+  size_ty PrevOffset = 0;
+
+  for (auto Str : Order) {
+    auto& Offset = Offsets.find(Str)->second;
+
+    if (TailMerge && Prev.ends_with(Str)) {
+      Offset = PrevOffset + Prev.size() - Str.size();
+      continue;
+    }
+
+    Offset = Buffer.size();
+    Buffer.insert(Buffer.end(), Str.begin(), Str.end());
+    Buffer.push_back('\x00');
+
+    Prev = Str;
+    PrevOffset = Offset;
+  }
+}
+
+StringTableBuilder::size_ty StringTableBuilder::getOffset(StringRef Str) const {
+  utils_assert(Finalized, "string table is not laid out yet");
+
+  auto Iter = Offsets.find(std::string_view(Str.data(), Str.size()));
+  if (Iter == Offsets.end()) {
+    utils::unreachable("cant find Str in string table");
+  }
+
+  return Iter->second;
+}
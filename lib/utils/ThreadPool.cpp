@@ -0,0 +1,115 @@
+#include "utils/ThreadPool.hpp"
+#include <algorithm>
+#include <utility>
+
+using namespace utils;
+
+ThreadPool::ThreadPool(unsigned Threads) {
+  if (!Threads) {
+    Threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned i = 0; i < Threads; ++i) {
+    Queues.push_back(std::make_unique<Queue>());
+  }
+
+  for (unsigned i = 0; i < Threads; ++i) {
+    Workers.emplace_back([this, i] { run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Stop = true;
+  }
+  Wake.notify_all();
+
+  for (auto& Worker : Workers) {
+    Worker.join();
+  }
+}
+
+void ThreadPool::submit(Task Job) {
+  /// counted before any worker can pop it, else the pop and the finish may
+  /// come first and wrap both counters around
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    ++Pending;
+    ++Queued;
+  }
+
+  auto& Target = *Queues[NextQueue++ % Queues.size()];
+  {
+    std::lock_guard<std::mutex> Guard(Target.Lock);
+    Target.Tasks.push_back(std::move(Job));
+  }
+  Wake.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> Guard(Lock);
+  Idle.wait(Guard, [this] { return !Pending; });
+
+  if (Error) {
+    std::rethrow_exception(std::exchange(Error, nullptr));
+  }
+}
+
+bool ThreadPool::pop(unsigned Self, Task& Out) {
+  auto Count = Queues.size();
+
+  for (std::size_t i = 0; i < Count; ++i) {
+    auto& Victim = *Queues[(Self + i) % Count];
+    std::lock_guard<std::mutex> Guard(Victim.Lock);
+
+    if (Victim.Tasks.empty()) {
+      continue;
+    }
+
+    /// own tasks LIFO, stolen ones FIFO
+    if (!i) {
+      Out = std::move(Victim.Tasks.back());
+      Victim.Tasks.pop_back();
+    } else {
+      Out = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+    }
+
+    --Queued;
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::run(unsigned Self) {
+  for (;;) {
+    Task Job;
+
+    if (pop(Self, Job)) {
+      std::exception_ptr Thrown;
+      try {
+        Job();
+      } catch (...) {
+        Thrown = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (Thrown && !Error) {
+        Error = std::move(Thrown);
+      }
+      if (!--Pending) {
+        Idle.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> Guard(Lock);
+    Wake.wait(Guard, [this] { return Stop || Queued; });
+
+    if (Stop && !Queued) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#include "utils/output.hpp"
+#include "utils/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace utils;
+
+alignas(64) const char OutputFile::ZeroPage[OutputFile::ZeroPageSize] = {};
+
+OutputFile OutputFile::open(ADT::StringRef Path) {
+  OutputFile File;
+
+  if (Path == "-") {
+    File.fd = STDOUT_FILENO;
+    return File;
+  }
+
+  File.fd = ::open(Path.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (File.fd < 0) {
+    utils::fatal("Failed to open output file");
+  }
+
+  return File;
+}
+
+void OutputFile::flush() {
+  auto* Iov = Pending.data();
+  auto* End = Pending.data() + Pending.size();
+
+  while (Iov != End) {
+    auto Cnt = static_cast<int>(std::min<std::ptrdiff_t>(End - Iov, IOV_MAX));
+
+    auto Done = ::writev(fd, Iov, Cnt);
+    if (Done < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Done < 0) {
+      utils::fatal("Failed to write output file");
+    }
+
+    /// skip what went out, a short write leaves a partial iovec behind
+    auto Left = static_cast<std::size_t>(Done);
+    while (Iov != End && Left >= Iov->iov_len) {
+      Left -= Iov->iov_len;
+      ++Iov;
+    }
+    if (Left) {
+      Iov->iov_base = static_cast<char*>(Iov->iov_base) + Left;
+      Iov->iov_len -= Left;
+    }
+  }
+
+  Pending.clear();
+}
+
+bool OutputFile::seekable() const { return ::lseek(fd, 0, SEEK_CUR) >= 0; }
+
+void OutputFile::pwrite(const void* Data, std::size_t N, std::size_t Offset) {
+  auto* Cur = static_cast<const char*>(Data);
+
+  while (N) {
+    auto Done = ::pwrite(fd, Cur, N, static_cast<off_t>(Offset));
+    if (Done < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Done < 0) {
+      utils::fatal("Failed to write output file");
+    }
+
+    Cur += Done;
+    N -= Done;
+    Offset += Done;
+  }
+}
+
+OutputFile::OutputFile(OutputFile&& Other)
+    : fd(Other.fd), Size(Other.Size), Pending(std::move(Other.Pending)) {
+  Other.fd = -1;
+  Other.Size = 0;
+}
+
+/// nothing pending is written here, the buffers it points into may be gone
+OutputFile::~OutputFile() {
+  if (fd > STDERR_FILENO) {
+    ::close(fd);
+  }
+}
@@ -0,0 +1,86 @@
+#include "utils/source.hpp"
+#include "utils/logger.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace utils;
+
+SourceBuffer SourceBuffer::open(ADT::StringRef Path) {
+  SourceBuffer Source;
+
+  if (Path == "-") {
+    Source.readAll(STDIN_FILENO);
+    return Source;
+  }
+
+  int fd = ::open(Path.str().c_str(), O_RDONLY);
+  if (fd < 0) {
+    utils::fatal("Failed to open file");
+  }
+
+  struct stat Stat;
+  if (::fstat(fd, &Stat) == 0 && S_ISREG(Stat.st_mode) && Stat.st_size > 0) {
+    void* Map = ::mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (Map != MAP_FAILED) {
+      /// the lexer walks the file front to back exactly once
+      ::madvise(Map, Stat.st_size, MADV_SEQUENTIAL);
+
+      Source.Data = static_cast<const char*>(Map);
+      Source.Size = Stat.st_size;
+      Source.Mapped = true;
+      ::close(fd); // the mapping holds its own reference
+      return Source;
+    }
+  }
+
+  Source.readAll(fd);
+  ::close(fd);
+  return Source;
+}
+
+void SourceBuffer::readAll(int fd) {
+  constexpr std::size_t ChunkSize = 64 * 1024;
+
+  for (;;) {
+    auto Used = Buffered.size();
+    Buffered.resize(Used + ChunkSize);
+
+    auto Got = ::read(fd, Buffered.data() + Used, ChunkSize);
+    if (Got < 0 && errno == EINTR) {
+      Buffered.resize(Used);
+      continue;
+    }
+    if (Got < 0) {
+      utils::fatal("Failed to read file");
+    }
+
+    Buffered.resize(Used + Got);
+    if (Got == 0) {
+      break;
+    }
+  }
+
+  Data = Buffered.data();
+  Size = Buffered.size();
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& Other)
+    : Size(Other.Size), Mapped(Other.Mapped),
+      Buffered(std::move(Other.Buffered)) {
+  /// a moved std::string may relocate its (small) storage
+  Data = Mapped ? Other.Data : Buffered.data();
+
+  Other.Data = nullptr;
+  Other.Size = 0;
+  Other.Mapped = false;
+}
+
+SourceBuffer::~SourceBuffer() {
+  if (Mapped) {
+    ::munmap(const_cast<char*>(Data), Size);
+  }
+}
@@ -0,0 +1,21 @@
+# mc --function-sections -c 10.function_sections.s -o 10.function_sections.o
+.bss
+.data
+.text
+.globl main
+main:
+	ADDI a0, a0, 1
+	JAL ra, fn0
+	JAL ra, fn1
+	JALR x0, 0(ra)
+# each function from its .globl label on takes a .text.<label>, a local
+# label stays in the one before
+.globl fn0
+fn0:
+	BEQ a0, a1, fn0_0
+	ADDI a0, a0, -1
+fn0_0:
+	JALR x0, 0(ra)
+.globl fn1
+fn1:
+	JAL x0, fn0
@@ -0,0 +1,36 @@
+# mc --symbol-ordering-file 11.ordering.txt -c 11.ordering.s -o 11.ordering.o
+# mc --profile 11.profile.txt [--split-cold] -c 11.ordering.s -o 11.ordering.o
+.bss
+.data
+.text
+.globl main
+main:
+	JAL ra, hot
+	JAL ra, warm
+	JAL ra, fa
+	JALR x0, 0(ra)
+.globl cold
+cold:
+	ADDI a0, a0, 3
+	JALR x0, 0(ra)
+.globl warm
+warm:
+	ADDI a0, a0, 2
+	BEQ a0, a1, warm
+	JALR x0, 0(ra)
+.globl hot
+hot:
+	ADDI a0, a0, 1
+	JALR x0, 0(ra)
+# fa runs into fb, fb into fc: they move as one, in this order, as hot as
+# fc. listed fc, fb, fa they still come fa, fb, fc, and split cold they
+# stay out of .text.unlikely
+.globl fa
+fa:
+	ADDI a0, a0, 1
+.globl fb
+fb:
+	ADDI a0, a0, 1
+.globl fc
+fc:
+	JALR x0, 0(ra)
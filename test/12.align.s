@@ -0,0 +1,33 @@
+# mc [--align-functions=16] [--align-loops=8] -c 12.align.s -o 12.align.o
+.bss
+.data
+	.half 1
+	.p2align 3, 0xff
+	.half 2
+	.p2align 3, 0, 2
+	.half 3
+# .align takes the power of two as .p2align does, 0 leaves it be
+	.align 3
+	.half 4
+	.align 0
+	.half 5
+.text
+.globl main
+main:
+	ADDI a0, a0, 1
+# within max-skip the padding goes in, past it none at all
+	.p2align 3, , 4
+main_0:
+	ADDI a0, a0, 1
+	.p2align 4, , 2
+main_1:
+	ADDI a0, a0, 1
+	BNE a0, a1, main_1
+	JALR x0, 0(ra)
+.globl fn0
+fn0:
+	ADDI a0, a0, -1
+fn0_0:
+	ADDI a1, a1, 1
+	BLT a1, a0, fn0_0
+	JALR x0, 0(ra)
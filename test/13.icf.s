@@ -0,0 +1,47 @@
+# mc --icf -c 13.icf.s -o 13.icf.o
+.bss
+.data
+.text
+.globl main
+main:
+	JAL ra, fa
+	JAL ra, fb
+	JAL ra, fc
+	JAL ra, fd
+	JAL ra, fe
+	JAL ra, ff
+	JALR x0, 0(ra)
+# fa and fb assemble the same, local labels and calls included: fb
+# becomes an alias of fa
+.globl fa
+fa:
+	ADDI a0, a0, 1
+loopa:
+	BNE a0, a1, loopa
+	JAL x0, fc
+.globl fb
+fb:
+	ADDI a0, a0, 1
+loopb:
+	BNE a0, a1, loopb
+	JAL x0, fc
+# fc and fd differ in one imm, both stay
+.globl fc
+fc:
+	ADDI a0, a0, 2
+	JALR x0, 0(ra)
+.globl fd
+fd:
+	ADDI a0, a0, 3
+	JALR x0, 0(ra)
+# fe runs into ff, ff into fg. fe and ff are the same inst but not the
+# same function, both stay
+.globl fe
+fe:
+	ADDI a0, a0, 1
+.globl ff
+ff:
+	ADDI a0, a0, 1
+.globl fg
+fg:
+	JALR x0, 0(ra)
@@ -0,0 +1,13 @@
+.bss
+.data
+.text
+.globl main
+main:
+# a literal is the 20-bit upper imm, as GAS and llvm-mc take it
+	LUI a0, 1
+	LUI a1, 0x12345
+	LUI a2, 0xfffff
+	LUI a3, 0
+	AUIPC t0, 1
+	AUIPC t1, 0x80000
+	JALR x0, 0(ra)
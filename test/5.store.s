@@ -0,0 +1,17 @@
+.bss
+.data
+.text
+.globl main
+main:
+# the data reg is rs2, the reg in parens rs1
+	SD t0, 8(sp)
+	SW t0, 12(sp)
+	SH a1, -2(a0)
+	SB a2, 15(a3)
+	SD x0, 0(s0)
+# an amo names rd and rs2 before its (rs1)
+	AMOADD.W a0, a1, (a2)
+	AMOSWAP.D t0, t1, (sp)
+# loads are unchanged
+	LD t0, 8(sp)
+	LW a1, -2(a0)
@@ -0,0 +1,28 @@
+.bss
+.data
+.text
+.globl main
+main:
+# in reach, each keeps its short form
+	BEQ x1, x2, main_0
+	JAL x0, main_0
+	JAL ra, main_0
+main_0:
+# out of the 4KiB of a branch, it jumps over a jal x0 instead
+	BEQ x1, x2, main_1
+	BNE x1, x2, main_1
+	BLT x1, x2, main_1
+	BGEU x1, x2, main_1
+	.balign 8192
+main_1:
+# out of the 1MiB of a jal, one that links becomes auipc+jalr through ra,
+# a plain jump or branch may only take t1 under relax
+	JAL ra, main_2
+	.option push
+	.option relax
+	JAL x0, main_2
+	BEQ x1, x2, main_2
+	.option pop
+	.balign 2097152
+main_2:
+	JALR x0, 0(ra)
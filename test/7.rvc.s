@@ -0,0 +1,95 @@
+.bss
+.data
+.text
+.option rvc
+.globl main
+main:
+# each compressed form, with the immediates at its bounds and one past
+	ADDI x0, x0, 0
+	ADDI a0, x0, 31
+	ADDI a0, x0, -32
+	ADDI a0, x0, 32
+	ADDI a0, a1, 0
+	ADD a0, x0, a1
+	ADDI a0, a0, 31
+	ADDI a0, a0, -32
+	ADDI a0, a0, 32
+	ADDI sp, sp, 496
+	ADDI sp, sp, -512
+	ADDI sp, sp, 512
+	ADDI a0, sp, 4
+	ADDI a0, sp, 1020
+	ADDI a0, sp, 1024
+	ADDIW a0, a0, -32
+	ADDIW a0, a0, 32
+	ADD a0, a0, a6
+	ADD a0, a6, a0
+	SUB s0, s0, a5
+	SUB s0, a5, s0
+	SUBW s0, s0, a5
+	ADDW s0, a5, s0
+	XOR s1, s1, a0
+	OR s1, a0, s1
+	AND s1, s1, a0
+	AND s1, s1, a6
+	ANDI a5, a5, 31
+	ANDI a5, a5, -32
+	ANDI a5, a5, 32
+	SLLI a6, a6, 1
+	SLLI a6, a6, 63
+	SRLI a5, a5, 63
+	SRAI a5, a5, 1
+	SRAI a6, a6, 1
+	LW a0, 252(sp)
+	LW a0, 256(sp)
+	LW a0, 124(a1)
+	LW a0, 128(a1)
+	LD t0, 504(sp)
+	LD t0, 512(sp)
+	LD a0, 248(a1)
+	LD a0, 256(a1)
+	SD t0, 504(sp)
+	SD t0, 512(sp)
+	SD a0, 248(a1)
+	SD a0, 4(a6)
+	SW t0, 252(sp)
+	SW t0, 256(sp)
+	SW a0, 124(a1)
+	SW a0, 128(a1)
+	LUI a0, 31
+	LUI a0, 0xfffe0
+	LUI a0, 32
+	LUI sp, 1
+	EBREAK
+# the branches and jumps come in C forms as they are written
+	c.beqz a0, main_0
+	c.bnez s0, main_0
+	c.j main_0
+main_0:
+	JALR ra, 0(a1)
+# out of their reach they take the 32-bit forms
+	c.beqz a0, main_1
+	c.bnez s0, main_1
+	c.j main_2
+	.balign 512
+main_1:
+	c.j main_2
+	.balign 4096
+main_2:
+# written 32-bit, in reach they narrow to c.beqz, c.bnez and c.j. a branch
+# on a reg outside x8-x15 or a jal that links stays as written
+	BEQ a0, x0, main_3
+	BNE x0, s0, main_3
+	JAL x0, main_3
+	BEQ a0, a1, main_3
+	BNE t0, x0, main_3
+	JAL ra, main_3
+main_3:
+	BEQ a0, x0, main_4
+	JAL x0, main_4
+	.balign 512
+main_4:
+	JAL x0, main_5
+	.balign 4096
+main_5:
+	JALR x0, 0(ra)
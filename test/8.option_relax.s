@@ -0,0 +1,20 @@
+.bss
+.data
+.text
+.option relax
+.globl main
+main:
+# a call is R_RISCV_CALL_PLT, each relocation the linker may shrink is
+# paired with an R_RISCV_RELAX
+	call foo
+	tail foo
+	lui a0, %hi(foo)
+	addi a0, a0, %lo(foo)
+	.option push
+	.option norelax
+	call foo
+	.option pop
+# the padding of an .align is left whole, under an R_RISCV_ALIGN
+	.p2align 4
+main_0:
+	JALR x0, 0(ra)
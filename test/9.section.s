@@ -0,0 +1,34 @@
+.bss
+.data
+.text
+.globl main
+main:
+	JALR x0, 0(ra)
+# flags and types by name, then as written
+.section .text.hot
+hot:
+	ADDI a0, a0, 1
+	JALR x0, 0(ra)
+.section .rodata.cst
+	.word 42
+.section .sdata
+	.dword 7
+.section .sbss
+	.zero 0
+.section .init_array
+	.dword 0
+.section .my_text, "ax", @progbits
+	ADDI a0, a0, 2
+.section .my_data, "aw"
+	.half 1
+.section .my_bss, "aw", @nobits
+	.zero 0
+.section .my_note, "", @note
+	.word 1
+.section .my_fini, "aw", @fini_array
+	.dword 0
+# back to a section seen before, its contents go on
+.section .text.hot
+	JALR x0, 0(ra)
+.text
+	JALR x0, 0(ra)